@@ -0,0 +1,171 @@
+// arbiter.cpp
+#include "arbiter.hpp"
+#include "log.hpp"
+#include <cassert>
+#include <cstring>
+
+static const char* const ARB_POLICY_NAMES[] = {
+    "round-robin", "fixed-priority", "oldest-first", "lottery", "weighted-share"
+};
+
+const char* arb_policy_name(ArbPolicy p){
+    return ARB_POLICY_NAMES[(int)p];
+}
+
+bool parse_arb_policy(const char* name, ArbPolicy& out){
+    for (int i = 0; i < 5; i++) {
+        if (!strcmp(name, ARB_POLICY_NAMES[i])) {
+            out = (ArbPolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+Arbiter::Arbiter(int num_cores_)
+    : num_cores(num_cores_),
+      weights(num_cores_, 1),
+      pass(num_cores_, 0),
+      ready_since(num_cores_, 0),
+      granted(num_cores_, 0),
+      starved(num_cores_, 0),
+      wait_cycles(num_cores_, 0),
+      contended(num_cores_, 0),
+      waits(num_cores_)
+{}
+
+void Arbiter::set_weight(int core_id, uint32_t w){
+    assert(core_id >= 0 && core_id < num_cores);
+    weights[core_id] = w ? w : 1;
+}
+
+void Arbiter::set_seed(uint64_t seed){
+    rng = seed ? seed : 0x9e3779b97f4a7c15ull;
+}
+
+uint64_t Arbiter::next_random(){
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545f4914f6cdd1dull;
+}
+
+void Arbiter::on_ready(int core_id, uint64_t now){
+    ready_since[core_id] = now;
+    contended[core_id] = 1;
+    // a core back from a long stall may bank at most one full stride of
+    // credit, so it can catch up on short misses but not monopolize the bus
+    if (pass[core_id] + STRIDE_ONE < virtual_time) pass[core_id] = virtual_time - STRIDE_ONE;
+}
+
+// ready core that `better` prefers over every other, scanning from rr_next
+// so that ties go to the next core in round-robin order
+template <typename Better>
+int Arbiter::best_from_rr(const CoreSet& ready, Better better) const {
+    int first = ready.find_next(rr_next);
+    int best = first;
+    for (int k = first; ; ) {
+        k = ready.find_next(k + 1 == num_cores ? 0 : k + 1);
+        if (k == first) break;
+        if (better(k, best)) best = k;
+    }
+    return best;
+}
+
+int Arbiter::pick(const CoreSet& ready){
+    if (ready.empty()) return -1;
+    switch (pol) {
+        case ArbPolicy::RoundRobin:
+            return ready.find_next(rr_next);
+        case ArbPolicy::FixedPriority:
+            return ready.find_next(0);
+        case ArbPolicy::OldestFirst:
+            return best_from_rr(ready, [&](int a, int b) { return ready_since[a] < ready_since[b]; });
+        case ArbPolicy::WeightedShare:
+            return best_from_rr(ready, [&](int a, int b) { return pass[a] < pass[b]; });
+        case ArbPolicy::Lottery: {
+            uint64_t tickets = 0;
+            ready.for_each([&](int k) { tickets += weights[k]; });
+            uint64_t draw = next_random() % tickets;
+            int winner = -1;
+            ready.for_each([&](int k) {
+                if (winner >= 0) return;
+                if (draw < weights[k]) winner = k;
+                else                   draw -= weights[k];
+            });
+            return winner;
+        }
+    }
+    return -1;
+}
+
+void Arbiter::on_grant(int core_id, uint64_t now){
+    uint64_t w = now - ready_since[core_id];
+    waits[core_id].record(w);
+    wait_cycles[core_id] += w;
+    granted[core_id]++;
+    if (w > starve_after) starved[core_id]++;
+
+    virtual_time = pass[core_id];
+    pass[core_id] += STRIDE_ONE / weights[core_id];
+    rr_next = (core_id + 1) % num_cores;
+}
+
+LatencyHistogram Arbiter::total_wait() const {
+    LatencyHistogram h;
+    for (const auto& w : waits) h.merge(w);
+    return h;
+}
+
+uint64_t Arbiter::total_starvation_events() const {
+    uint64_t n = 0;
+    for (uint64_t s : starved) n += s;
+    return n;
+}
+
+int Arbiter::starving(const CoreSet& ready, uint64_t now) const {
+    int n = 0;
+    ready.for_each([&](int k) {
+        if (now - ready_since[k] > starve_after) n++;
+    });
+    return n;
+}
+
+double Arbiter::jain_index() const {
+    double sum = 0, sum_sq = 0;
+    int n = 0;
+    for (int c = 0; c < num_cores; c++) {
+        if (!contended[c]) continue;
+        // never granted counts as a rate of 0
+        double rate = granted[c] ? (double)granted[c] / (double)(wait_cycles[c] + granted[c]) / weights[c] : 0.0;
+        sum += rate;
+        sum_sq += rate * rate;
+        n++;
+    }
+    return n ? (sum * sum) / (n * sum_sq) : 1.0;
+}
+
+void Arbiter::print_summary(const CoreSet& ready, uint64_t now) const {
+    LatencyHistogram h = total_wait();
+    printf("Arbitration (%s): wait mean %.2f, p99 %llu, max %llu, Jain's fairness %.3f, starvation events %llu\n",
+        arb_policy_name(pol), h.mean(),
+        (unsigned long long)h.percentile(0.99), (unsigned long long)h.max(),
+        jain_index(), (unsigned long long)(total_starvation_events() + starving(ready, now)));
+}
+
+void Arbiter::print_report(const CoreSet& ready, uint64_t now) const {
+    printf("\n --- ARBITRATION (%s, cycles ready -> granted) --- \n", arb_policy_name(pol));
+    printf("%4s %6s %8s %8s %6s %6s %6s %8s\n",
+        "core", "weight", "grants", "mean", "p50", "p99", "max", "starved");
+    for (int c = 0; c < num_cores; c++) {
+        const LatencyHistogram& h = waits[c];
+        bool waiting = ready.test(c) && now - ready_since[c] > starve_after;
+        printf("%4d %6u %8llu %8.2f %6llu %6llu %6llu %8llu%s\n",
+            c, weights[c], (unsigned long long)granted[c], h.mean(),
+            (unsigned long long)h.percentile(0.50),
+            (unsigned long long)h.percentile(0.99),
+            (unsigned long long)h.max(),
+            (unsigned long long)starved[c], waiting ? "  (starving now)" : "");
+    }
+    printf("Jain's fairness index: %.3f\n", jain_index());
+}
@@ -0,0 +1,85 @@
+#ifndef ARBITER_HPP
+#define ARBITER_HPP
+
+#include <cstdint>
+#include <vector>
+#include "core_set.hpp"
+#include "latency.hpp"
+
+enum class ArbPolicy {
+    RoundRobin,    // first ready core after the last winner
+    FixedPriority, // lowest core id always wins
+    OldestFirst,   // ready the longest; ties go round-robin
+    Lottery,       // random draw, weighted by tickets
+    WeightedShare  // stride scheduling: grants in proportion to weight
+};
+
+const char* arb_policy_name(ArbPolicy p);
+// accepts the names above ("round-robin", "fixed-priority", ...)
+bool parse_arb_policy(const char* name, ArbPolicy& out);
+
+// Picks which ready core gets the cache port each cycle and measures what
+// that costs each core: cycles from becoming ready (op pending, cache idle)
+// to winning arbitration, grants, and waits past a starvation threshold.
+class Arbiter {
+public:
+    explicit Arbiter(int num_cores = 0);
+
+    void set_policy(ArbPolicy p) { pol = p; }
+    ArbPolicy policy() const { return pol; }
+    // lottery tickets / QoS share, default 1
+    void set_weight(int core_id, uint32_t w);
+    uint32_t weight(int core_id) const { return weights[core_id]; }
+    void set_seed(uint64_t seed);
+    // a wait longer than this counts as a starvation event
+    void set_starvation_threshold(uint64_t cycles) { starve_after = cycles; }
+    uint64_t starvation_threshold() const { return starve_after; }
+
+    void on_ready(int core_id, uint64_t now);
+    // -1 when no core is ready
+    int pick(const CoreSet& ready);
+    void on_grant(int core_id, uint64_t now);
+    // round-robin pointer, also the tie-break start for the other policies
+    int next() const { return rr_next; }
+
+    const LatencyHistogram& wait(int core_id) const { return waits[core_id]; }
+    LatencyHistogram total_wait() const;
+    uint64_t grants(int core_id) const { return granted[core_id]; }
+    uint64_t starvation_events(int core_id) const { return starved[core_id]; }
+    uint64_t total_starvation_events() const;
+    // ready cores whose current, still unserved wait is past the threshold
+    int starving(const CoreSet& ready, uint64_t now) const;
+
+    // Jain's index over each core's grant rate while contending (grants per
+    // cycle spent waiting or winning) divided by its weight: 1 is perfectly
+    // fair, 1/n means one core got everything
+    double jain_index() const;
+
+    void print_summary(const CoreSet& ready, uint64_t now) const;
+    void print_report(const CoreSet& ready, uint64_t now) const;
+
+private:
+    static constexpr uint64_t STRIDE_ONE = 1u << 20;
+
+    ArbPolicy pol = ArbPolicy::RoundRobin;
+    int num_cores;
+    int rr_next = 0;
+    uint64_t starve_after = 1000;
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    uint64_t virtual_time = 0; // pass of the last WeightedShare winner
+
+    std::vector<uint32_t> weights;
+    std::vector<uint64_t> pass;
+    std::vector<uint64_t> ready_since;
+    std::vector<uint64_t> granted;
+    std::vector<uint64_t> starved;
+    std::vector<uint64_t> wait_cycles;
+    std::vector<uint8_t> contended; // was ever ready
+    std::vector<LatencyHistogram> waits;
+
+    uint64_t next_random();
+    template <typename Better>
+    int best_from_rr(const CoreSet& ready, Better better) const;
+};
+
+#endif
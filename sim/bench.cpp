@@ -0,0 +1,350 @@
+// bench.cpp
+// Host-performance benchmarks: how fast the simulator itself runs.
+//
+//   g++ -O2 bench.cpp -o bench
+//   ./bench                                   report only
+//   ./bench --write-baseline bench_baseline.json
+//   ./bench --baseline bench_baseline.json    compare; exits 1 on a regression
+//   ./bench --filter pingpong --reps 9 --tolerance 10
+//   ./bench --filter fuzz_64 --phases          per-phase host time of System::step
+
+#include "system.cpp"
+#include "log.cpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static uint32_t bench_lcg(uint32_t& x) {
+    x = x * 1664525u + 1013904223u;
+    return x;
+}
+
+// every core works on its own lines
+static void wl_private(System& sys, int n) {
+    for (int i = 0; i < n; i++) {
+        auto* c = sys.get_core(i);
+        uint32_t base = 0x10000 + (uint32_t)i * 0x400;
+        for (int k = 0; k < 5000; k++) {
+            uint32_t a = base + (uint32_t)(k % 8) * 32;
+            c->add_op(OpType::STORE, a, k);
+            c->add_op(OpType::LOAD,  a);
+        }
+    }
+}
+
+// everyone reads the same few lines
+static void wl_read_shared(System& sys, int n) {
+    for (int i = 0; i < n; i++) {
+        auto* c = sys.get_core(i);
+        for (int k = 0; k < 10000; k++) c->add_op(OpType::LOAD, 0x20000 + (uint32_t)(k % 4) * 32);
+    }
+}
+
+// pairs of cores alternate stores to a shared line
+static void wl_pingpong(System& sys, int n) {
+    for (int i = 0; i < n; i++) {
+        auto* c = sys.get_core(i);
+        uint32_t a = 0x30000 + (uint32_t)(i / 2) * 32;
+        for (int k = 0; k < 5000; k++) {
+            c->add_op(OpType::STORE, a, k + i);
+            c->add_op(OpType::LOAD,  a);
+        }
+    }
+}
+
+// all cores store to one line (test_scaling_write_shared)
+static void wl_write_storm(System& sys, int n) {
+    for (int i = 0; i < n; i++) {
+        auto* c = sys.get_core(i);
+        for (int k = 0; k < 8000; k++) c->add_op(OpType::STORE, 0x1000, k + i);
+    }
+}
+
+// random loads/stores over lines that conflict in the cache
+static void wl_fuzz(System& sys, int n) {
+    for (int i = 0; i < n; i++) {
+        auto* c = sys.get_core(i);
+        uint32_t seed = 0x9e3779b9u * (uint32_t)(i + 1);
+        for (int k = 0; k < 5000; k++) {
+            uint32_t r = bench_lcg(seed);
+            uint32_t a = 0x40000 + (r % 64) * 32 * 7;
+            if ((r >> 28) & 1u) c->add_op(OpType::STORE, a, r & 0xFF);
+            else                c->add_op(OpType::LOAD,  a);
+        }
+    }
+}
+
+struct BenchWorkload {
+    const char* name;
+    void (*build)(System&, int);
+};
+
+static const BenchWorkload WORKLOADS[] = {
+    {"private",     wl_private},
+    {"read_shared", wl_read_shared},
+    {"pingpong",    wl_pingpong},
+    {"write_storm", wl_write_storm},
+    {"fuzz",        wl_fuzz},
+};
+static const int CORE_COUNTS[] = {2, 4, 8, 16, 32, 64};
+
+struct BenchResult {
+    std::string name;
+    double ns_per_cycle;
+    double ops_per_sec;
+    uint64_t cycles;
+    uint64_t ops;
+    long peak_rss_kb;
+};
+
+#ifdef _WIN32
+// no fork here, so the column is the process peak: the largest workload so far
+#define RSS_COLUMN "proc peak KB"
+static long peak_rss_kb() {
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return (long)(pmc.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+}
+#else
+#define RSS_COLUMN "peak RSS KB"
+static long peak_rss_kb(const struct rusage& ru) {
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024; // bytes on macOS
+#else
+    return ru.ru_maxrss;        // kilobytes on Linux
+#endif
+}
+#endif
+
+static void print_phases(const BenchWorkload& w, int ncores) {
+    System sys(ncores);
+    sys.set_print_report(false);
+    sys.enable_phase_profile(true);
+    w.build(sys, ncores);
+    sys.run(UINT32_MAX);
+
+    QUIET = false;
+    sys.get_phase_profile().print_report();
+    QUIET = true;
+}
+
+static constexpr double MIN_REP_NS = 20e6;
+
+static BenchResult run_one(const BenchWorkload& w, int ncores, int reps) {
+    BenchResult best;
+    best.name = std::string(w.name) + "_" + std::to_string(ncores);
+    best.ns_per_cycle = 0;
+
+    for (int r = 0; r < reps; r++) {
+        // short workloads are re-run until the rep covers MIN_REP_NS of host time
+        double ns = 0;
+        uint64_t cycles = 0;
+        uint64_t ops = 0;
+        int runs = 0;
+        while (ns < MIN_REP_NS) {
+            System sys(ncores);
+            sys.set_print_report(false);
+            w.build(sys, ncores);
+
+            auto t0 = std::chrono::steady_clock::now();
+            sys.run(UINT32_MAX);
+            auto t1 = std::chrono::steady_clock::now();
+
+            ns += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+            cycles += sys.get_stats().cycles;
+            ops += sys.get_stats().instructions;
+            runs++;
+        }
+        double ns_per_cycle = ns / (double)cycles;
+
+        // keep the fastest repetition, it has the least host noise
+        if (r == 0 || ns_per_cycle < best.ns_per_cycle) {
+            best.ns_per_cycle = ns_per_cycle;
+            best.ops_per_sec = (double)ops / (ns * 1e-9);
+            best.cycles = cycles / runs;
+            best.ops = ops / runs;
+        }
+    }
+    best.peak_rss_kb = 0;
+    return best;
+}
+
+// Each workload runs in a forked child and its peak RSS is read from
+// wait4(), so a row is not the high-water mark of every row before it.
+// The child starts from the bench's own few MB.
+static BenchResult measure(const BenchWorkload& w, int ncores, int reps) {
+#ifdef _WIN32
+    BenchResult r = run_one(w, ncores, reps);
+    r.peak_rss_kb = peak_rss_kb();
+    return r;
+#else
+    struct Sample { double ns_per_cycle, ops_per_sec; uint64_t cycles, ops; };
+    int fds[2];
+    fflush(stdout);
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(2);
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(2);
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        BenchResult r = run_one(w, ncores, reps);
+        Sample s{r.ns_per_cycle, r.ops_per_sec, r.cycles, r.ops};
+        _exit(write(fds[1], &s, sizeof(s)) == (ssize_t)sizeof(s) ? 0 : 1);
+    }
+    close(fds[1]);
+    Sample s{};
+    ssize_t got = read(fds[0], &s, sizeof(s));
+    close(fds[0]);
+    int status = 0;
+    struct rusage ru{};
+    wait4(pid, &status, 0, &ru);
+    if (got != (ssize_t)sizeof(s) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        fprintf(stderr, "%s_%d: benchmark child failed\n", w.name, ncores);
+        exit(2);
+    }
+    BenchResult r;
+    r.name = std::string(w.name) + "_" + std::to_string(ncores);
+    r.ns_per_cycle = s.ns_per_cycle;
+    r.ops_per_sec = s.ops_per_sec;
+    r.cycles = s.cycles;
+    r.ops = s.ops;
+    r.peak_rss_kb = peak_rss_kb(ru);
+    return r;
+#endif
+}
+
+// Reads the flat format written by write_baseline(); one entry per line:
+//   "name": {"ns_per_cycle": 1.23, "ops_per_sec": 456.7},
+static bool load_baseline(const char* path, std::vector<BenchResult>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char name[128];
+        BenchResult b{};
+        if (sscanf(line, " \"%127[^\"]\": {\"ns_per_cycle\": %lf, \"ops_per_sec\": %lf",
+                   name, &b.ns_per_cycle, &b.ops_per_sec) == 3) {
+            b.name = name;
+            out.push_back(b);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool write_baseline(const char* path, const std::vector<BenchResult>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "{\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        fprintf(f, "  \"%s\": {\"ns_per_cycle\": %.3f, \"ops_per_sec\": %.1f}%s\n",
+            results[i].name.c_str(), results[i].ns_per_cycle, results[i].ops_per_sec,
+            i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "}\n");
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // host timings only mean something on the machine that wrote them, so
+    // comparing is opt-in and no baseline lives in the tree
+    const char* baseline_path = nullptr;
+    const char* write_path = nullptr;
+    const char* filter = nullptr;
+    double tolerance = 15.0; // percent
+    int reps = 5;
+    bool phases = false;
+
+    for (int i = 1; i < argc; i++) {
+        if      (!strcmp(argv[i], "--baseline") && i + 1 < argc)       baseline_path = argv[++i];
+        else if (!strcmp(argv[i], "--write-baseline") && i + 1 < argc) write_path = argv[++i];
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc)         filter = argv[++i];
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc)      tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--reps") && i + 1 < argc)           reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--phases"))                         phases = true;
+        else {
+            fprintf(stderr, "usage: %s [--baseline f] [--write-baseline f] [--filter s] [--tolerance pct] [--reps n] [--phases]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    QUIET = true;
+
+    std::vector<BenchResult> baseline;
+    bool have_baseline = !write_path && baseline_path && load_baseline(baseline_path, baseline);
+
+    fprintf(stdout, "%-16s %10s %12s %14s %12s %10s  %s\n",
+        "workload", "cycles", "ns/cycle", "sim ops/s", RSS_COLUMN, "baseline", "");
+
+    std::vector<BenchResult> results;
+    int regressions = 0;
+    for (const BenchWorkload& w : WORKLOADS) {
+        for (int n : CORE_COUNTS) {
+            std::string name = std::string(w.name) + "_" + std::to_string(n);
+            if (filter && name.find(filter) == std::string::npos) continue;
+
+            BenchResult r = measure(w, n, reps);
+            results.push_back(r);
+
+            const BenchResult* base = nullptr;
+            for (const auto& b : baseline) if (b.name == r.name) base = &b;
+
+            const char* verdict = "";
+            double delta = 0.0;
+            if (base && base->ns_per_cycle > 0) {
+                delta = 100.0 * (r.ns_per_cycle - base->ns_per_cycle) / base->ns_per_cycle;
+                if (delta > tolerance) { verdict = "REGRESSION"; regressions++; }
+            }
+            if (base) {
+                fprintf(stdout, "%-16s %10llu %12.2f %14.0f %12ld %+9.1f%%  %s\n",
+                    r.name.c_str(), (unsigned long long)r.cycles, r.ns_per_cycle,
+                    r.ops_per_sec, r.peak_rss_kb, delta, verdict);
+            } else {
+                fprintf(stdout, "%-16s %10llu %12.2f %14.0f %12ld %10s\n",
+                    r.name.c_str(), (unsigned long long)r.cycles, r.ns_per_cycle,
+                    r.ops_per_sec, r.peak_rss_kb, "-");
+            }
+            if (phases) print_phases(w, n);
+        }
+    }
+
+    if (write_path) {
+        if (!write_baseline(write_path, results)) {
+            fprintf(stderr, "cannot write %s\n", write_path);
+            return 2;
+        }
+        fprintf(stdout, "baseline written to %s\n", write_path);
+        return 0;
+    }
+    if (!baseline_path) return 0;
+    if (!have_baseline) {
+        fprintf(stdout, "no baseline at %s (create one with --write-baseline)\n", baseline_path);
+        return 0;
+    }
+    if (regressions) {
+        fprintf(stdout, "%d regression(s) over %.0f%% tolerance\n", regressions, tolerance);
+        return 1;
+    }
+    fprintf(stdout, "no regressions (tolerance %.0f%%)\n", tolerance);
+    return 0;
+}
@@ -17,11 +17,113 @@ bool Bus::step(BusGrant& granted){
 
     granted.req = current;
     granted.flush = false;
+    granted.forwarded = false;
     granted.shared = false;
+    granted.latency = 0;
     busy = false;
     return true;
 }
 
 bool Bus::is_busy() const {
     return busy;
-}
\ No newline at end of file
+}
+
+void Bus::configure(const BusConfig& c){
+    cfg = c;
+    if (cfg.width_bytes == 0) cfg.width_bytes = LINE_SIZE;
+    if (cfg.clock_ratio == 0) cfg.clock_ratio = 1;
+}
+
+uint32_t Bus::line_cycles() const {
+    uint32_t beats = (LINE_SIZE + cfg.width_bytes - 1) / cfg.width_bytes;
+    return beats * cfg.clock_ratio;
+}
+
+// a soft slot goes into the earliest gap at or after `ready`
+void Bus::place(uint64_t ready, uint64_t len, bool soft){
+    uint64_t start = ready;
+    size_t i = 0;
+    for (; i < slots.size(); i++) {
+        if (slots[i].end <= start) continue;
+        if (slots[i].start >= start + len) break;
+        start = slots[i].end;
+    }
+    slots.insert(slots.begin() + i, {start, start + len, soft});
+}
+
+// earliest gap between fills at or after `ready` that fits `len` cycles;
+// returns the cycle the last beat lands
+uint64_t Bus::reserve(uint64_t now, uint64_t ready, uint64_t len){
+    size_t done = 0;
+    while (done < slots.size() && slots[done].end <= now) done++;
+    slots.erase(slots.begin(), slots.begin() + done);
+
+    uint64_t start = ready;
+    for (const Slot& s : slots) {
+        if (s.soft || s.end <= start) continue;
+        if (s.start >= start + len) break;
+        start = s.end;
+    }
+    // soft transfers in the way move to the next idle gap
+    std::vector<Slot> bumped;
+    for (size_t i = 0; i < slots.size();) {
+        if (slots[i].soft && slots[i].start < start + len && slots[i].end > start) {
+            bumped.push_back(slots[i]);
+            slots.erase(slots.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    place(start, len, false);
+    for (const Slot& s : bumped) place(s.start, s.end - s.start, true);
+
+    stats.queued_cycles += start - ready;
+    stats.data_cycles += len;
+    return start + len;
+}
+
+void Bus::reserve_soft(uint64_t now, uint64_t len){
+    size_t done = 0;
+    while (done < slots.size() && slots[done].end <= now) done++;
+    slots.erase(slots.begin(), slots.begin() + done);
+    place(now, len, true);
+    stats.data_cycles += len;
+}
+
+void Bus::schedule(BusGrant& granted, bool fill, bool writeback, uint64_t now){
+    if (granted.req.type == BusReqType::BusAtomic) {
+        stats.far_atomics++;
+        uint64_t ready = now;
+        if (granted.flush) {
+            stats.writeback_lines++;
+            ready = reserve(now, now + cfg.c2c_latency, line_cycles());
+        }
+        granted.latency = (uint32_t)(reserve(now, ready + cfg.mem_latency, cfg.clock_ratio) - now);
+        return;
+    }
+    if (!fill) {
+        if (granted.req.type == BusReqType::BusUpd) {
+            stats.word_updates++;
+            reserve_soft(now, cfg.clock_ratio);
+        } else {
+            stats.addr_only++;
+        }
+        granted.latency = cfg.upgr_latency;
+        return;
+    }
+    if (writeback) {
+        stats.writeback_lines++;
+        reserve_soft(now, line_cycles());
+    }
+    bool c2c = granted.flush || granted.forwarded;
+    uint64_t done = reserve(now, now + (c2c ? cfg.c2c_latency : cfg.mem_latency), line_cycles());
+    granted.latency = (uint32_t)(done - now);
+    if (c2c) { stats.c2c_lines++; stats.c2c_fill_cycles += granted.latency; }
+    else     { stats.mem_lines++; stats.mem_fill_cycles += granted.latency; }
+}
+
+double Bus::utilization(uint64_t cycles) const {
+    if (cycles == 0) return 0.0;
+    double u = (double)stats.data_cycles / (double)cycles;
+    return u < 1.0 ? u : 1.0;
+}
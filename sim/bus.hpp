@@ -2,28 +2,68 @@
 #define BUS_HPP
 
 #include <cstdint>
+#include <utility>
+#include <vector>
 #include "config.hpp"
 
 enum class BusReqType {
     BusRd, // read miss (either shared or exclusive)
     BusRdX, // read for ownership (store miss)
-    BusUpgr // store hit in s
+    BusUpgr, // store hit in s
+    BusUpd,  // write-update: store to a shared (or missing) line, sharers keep it
+    BusAtomic // far atomic: every copy is dropped and memory performs the op
 };
 
 struct BusRequest {
     int cache_id;
     BusReqType type;
     uint32_t addr;
+    uint64_t data = 0; // the stored value, for BusUpd
+    uint8_t size = 4;  // bytes stored, for BusUpd
+    bool exclusive = false; // BusRd answered with ownership (migratory line)
 };
 
 struct BusGrant { 
     BusRequest req; 
     bool shared;
-    bool flush;
+    bool flush;       // a dirty owner supplied the line
+    bool forwarded;   // a clean peer (MESIF forwarder) supplied the line
+    uint32_t latency; // cycles from the grant until the requester completes
     uint8_t data[LINE_SIZE];
 };
 
+// Address and data phases are split: one address phase per cycle, while
+// line transfers take the earliest free gap on the data bus. A fill waits
+// its source latency, then takes LINE_SIZE / width_bytes beats of
+// clock_ratio core cycles.
+// BusUpgr is address-only and never touches the data bus; a BusUpd to a
+// line the writer holds moves one beat, the word. Both finish after
+// upgr_latency. A far atomic waits for a dirty copy to be written back,
+// then mem_latency, then returns its old value in one beat. The defaults
+// give the original flat 5 cycles from grant to completion.
+struct BusConfig {
+    uint32_t width_bytes  = LINE_SIZE; // data bus width
+    uint32_t clock_ratio  = 1;         // core cycles per bus cycle
+    uint32_t c2c_latency  = 4;         // to the first beat of a cache-to-cache transfer
+    uint32_t mem_latency  = 4;         // to the first beat of a memory fill
+    uint32_t upgr_latency = 5;         // invalidation / update round trip
+};
+
+struct BusTraffic {
+    uint64_t data_cycles = 0;   // core cycles the data bus was transferring
+    uint64_t c2c_lines = 0;
+    uint64_t mem_lines = 0;
+    uint64_t writeback_lines = 0;
+    uint64_t addr_only = 0;
+    uint64_t word_updates = 0;  // BusUpd beats without a line fill
+    uint64_t far_atomics = 0;   // BusAtomic round trips to memory
+    uint64_t queued_cycles = 0; // fill cycles lost waiting for the data bus
+    uint64_t c2c_fill_cycles = 0; // grant -> data, summed per source
+    uint64_t mem_fill_cycles = 0;
+};
+
 class Bus {
+    friend class ModelChecker;
 public:
     Bus();
 
@@ -31,9 +71,40 @@ public:
 
     bool step(BusGrant& granted);
     bool is_busy() const;
+
+    void configure(const BusConfig& c);
+    const BusConfig& config() const { return cfg; }
+    // core cycles to move one line
+    uint32_t line_cycles() const;
+
+    // reserves the data bus for the granted transaction and sets
+    // granted.latency; flush/forwarded must already say where the data
+    // comes from, `fill` whether the requester needs the line at all.
+    // A dirty victim drains from a victim buffer into idle data bus
+    // cycles; it never delays a fill.
+    void schedule(BusGrant& granted, bool fill, bool writeback, uint64_t now);
+
+    const BusTraffic& traffic() const { return stats; }
+    // fraction of `cycles` the data bus was busy
+    double utilization(uint64_t cycles) const;
 private:
     bool busy;
     BusRequest current;
+    BusConfig cfg;
+    // future data bus transfers as [start, end), sorted and disjoint. Soft
+    // ones (victim writebacks, update words) nobody waits on: fills ignore
+    // them and push them to the next idle gap.
+    struct Slot {
+        uint64_t start;
+        uint64_t end;
+        bool soft;
+    };
+    std::vector<Slot> slots;
+    BusTraffic stats;
+
+    uint64_t reserve(uint64_t now, uint64_t ready, uint64_t len);
+    void reserve_soft(uint64_t now, uint64_t len);
+    void place(uint64_t ready, uint64_t len, bool soft);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -4,6 +4,7 @@
 #include "memory.hpp"
 #include "log.hpp"
 #include <iostream>
+#include <cstring>
 
 Cache::Cache(int id, Bus* bus_, Memory* mem_, System* system)
     : cache_id(id),
@@ -12,10 +13,17 @@ Cache::Cache(int id, Bus* bus_, Memory* mem_, System* system)
       system(system),
       waiting_for_bus(false),
       busy(false),
-      wait_cycles(0),
+      ready_at(0),
       owner_core(nullptr)
 {}
 
+// write-update words covered by `size` bytes at line offset `off`
+uint8_t Cache::word_mask(uint32_t off, int size){
+    int first = off / WORD_SIZE;
+    int last = (off + size - 1) / WORD_SIZE;
+    return (uint8_t)(((1u << (last + 1)) - 1) & ~((1u << first) - 1));
+}
+
 
 // accept line from bus
 bool Cache::accept_request(Core* core, const MemOp& op){
@@ -27,31 +35,35 @@ bool Cache::accept_request(Core* core, const MemOp& op){
 
     printf("[Cache %d] op=%s addr=0x%x idx=%u t=%u | line.tag=%u waiting=%d busy=%d\n",
         cache_id,
-        (op.type == OpType::LOAD ? "LD" : "ST"),
+        op_type_name(op.type),
         op.addr, idx, t, line.tag,
         (int)waiting_for_bus, (int)busy);
 
     bool hit = (line.state != LineState::I) && (line.tag == t);
 
-    hit ? system->record_hit() : system->record_miss();
+    hit ? system->record_hit(cache_id) : system->record_miss(cache_id);
 
     busy = true;
     owner_core = core;
     current_op = op;
+    issue_cycle = system->now();
+    issue_hit = hit;
+    issue_req = LatencyReq::None;
     // if hit, run as usual
     // if miss & load -> BusRD
     // if hit & store & line=S -> BusUpgrade
     // if miss & store -> BusRdX
+    if (hit) local_access(line, op);
     if (op.type == OpType::LOAD){
         if (hit){
             waiting_for_bus = false;
-            wait_cycles = 1;
+            wait(1);
             printf("Load Hit at Cache %i\n", cache_id);
         } else {
             waiting_for_bus = true;
-            wait_cycles = 0;
             BusRequest req{cache_id, BusReqType::BusRd, op.addr};
-            system->record_bus_rd();
+            issue_req = LatencyReq::BusRd;
+            system->record_bus_rd(cache_id);
             if (!bus->request(req)){
                 printf("Load Miss at Cache %i\n", cache_id);
                 busy = false;
@@ -59,40 +71,78 @@ bool Cache::accept_request(Core* core, const MemOp& op){
             }
         }
     }
-    else if (op.type == OpType::STORE){
-        if (hit){
+    else {
+        // stores and atomics need the line in M; update protocols broadcast
+        // plain stores instead, and far atomics go to memory
+        bool update = op.type == OpType::STORE && is_write_update(protocol);
+        bool owned = hit && (line.state == LineState::E || line.state == LineState::M);
+        if (is_atomic(op.type) && far_atomics && !owned){
+            waiting_for_bus = true;
+            BusRequest req{cache_id, BusReqType::BusAtomic, op.addr, op.data};
+            issue_req = LatencyReq::BusAtomic;
+            system->record_far_atomic(cache_id);
+            if (!bus->request(req)) {
+                busy = false;
+                return false;
+            }
+        } else if (hit){
+            // the store performs now, together with the E->M change; a
+            // snoop granted before completion must already see the data
             if (line.state == LineState::E){
-                line.state = LineState::M;
+                set_state(line, op.addr, LineState::M);
+                perform_store(line);
                 waiting_for_bus = false;
-                wait_cycles = 1;
+                wait(1);
             } else if (line.state == LineState::M){
+                perform_store(line);
                 waiting_for_bus = false;
-                wait_cycles = 1;
-            } else if (line.state == LineState::S){
+                wait(1);
+            } else if (is_shared_copy(line.state) && update){
+                waiting_for_bus = true;
+
+                // update the other copies
+                BusRequest req{cache_id, BusReqType::BusUpd, op.addr, op.data, op.size};
+                issue_req = LatencyReq::BusUpd;
+                system->record_bus_upd(cache_id);
+                if (!bus->request(req)) {
+                    busy = false;
+                    return false;
+                }
+            } else if (is_shared_copy(line.state)){
                 waiting_for_bus = true;
-                wait_cycles = 0;
 
                 // invalidate others
                 BusRequest req{cache_id, BusReqType::BusUpgr, op.addr};
-                system->record_bus_upgr();
+                issue_req = LatencyReq::BusUpgr;
+                system->record_bus_upgr(cache_id);
                 if (!bus->request(req)) {
                     printf("Store hit at Cache %i\n", cache_id);
                     busy = false;
                     return false;
                 }
             }
+        } else if (update) {
+            // fetch the line and update any sharers in one transaction
+            waiting_for_bus = true;
+            BusRequest req{cache_id, BusReqType::BusUpd, op.addr, op.data, op.size};
+            issue_req = LatencyReq::BusUpd;
+            system->record_bus_upd(cache_id);
+            if (!bus->request(req)) {
+                busy = false;
+                return false;
+            }
         } else {
             // BusRdx
             waiting_for_bus = true;
             BusRequest req{cache_id, BusReqType::BusRdX, op.addr};
-            system->record_bus_rdx();
+            issue_req = LatencyReq::BusRdX;
+            system->record_bus_rdx(cache_id);
             if (!bus->request(req)) {
                 printf("Store miss at Cache %i\n", cache_id);
                 busy = false;
                 return false;
             }
             
-            wait_cycles = 0;
         }
     }
 
@@ -103,23 +153,22 @@ bool Cache::accept_request(Core* core, const MemOp& op){
 void Cache::step(){
     if (!busy) return;
     if (waiting_for_bus) return;
-    if (wait_cycles > 0) {
-        wait_cycles--;
-        return;
-    }
+    if (system->now() < ready_at) return;
 
 
     
     uint32_t idx = index(current_op.addr);
     CacheLine& line = lines[idx];
 
+    owner_core->record_transaction(issue_hit, issue_req, issue_cycle);
+
     if (current_op.type == OpType::LOAD){
         uint32_t offset = current_op.addr % LINE_SIZE;
-        uint32_t val = line.data[offset];
-        owner_core->notify_complete(val);
+        owner_core->notify_load(&line.data[offset]);
+    } else if (is_atomic(current_op.type)){
+        owner_core->notify_complete(atomic_old);
     } else {
-        uint32_t offset = current_op.addr % LINE_SIZE;
-        line.data[offset] = current_op.data;
+        // stores performed at accept (hit) or at the bus grant (miss)
         owner_core->notify_complete();
     }
 
@@ -139,36 +188,74 @@ SnoopResult Cache::snoop_and_update(const BusRequest& req){
 
     if (line.state == LineState::I || line.tag != t) return result;
         result.had_line = true;
-    if (line.state == LineState::M) {
+    if (line.migrated) {
+        // wanted elsewhere before this cache wrote it
+        line.migrated = false;
+        system->record_migratory_mispredict(cache_id, req.addr);
+    }
+    if (is_dirty(line.state)) {
         result.was_dirty = true;
         result.data = line.data.data();  
+    } else if (protocol == Protocol::MESIF && (line.state == LineState::F || line.state == LineState::E)) {
+        // the designated forwarder answers instead of memory
+        result.forwards = true;
+        result.data = line.data.data();
     }
 
     switch (req.type){
         case (BusReqType::BusRd):
             // if read
             printf("req type: BusRD\n");
-            if (line.state == LineState::E){
-                line.state = LineState::S;
+            if (req.exclusive){
+                // migratory line: the reader takes it over like a BusRdX
+                system->record_invalidation(cache_id, req.addr);
+                set_state(line, req.addr, LineState::I);
+            } else if (line.state == LineState::E || line.state == LineState::F){
+                // MESIF hands the forwarder role to the new reader
+                set_state(line, req.addr, LineState::S);
             } else if (line.state == LineState::M){
-                line.state = LineState::S;
+                // MOESI and Dragon keep the dirty data here instead of writing it back
+                set_state(line, req.addr, has_owner(protocol) ? LineState::O : LineState::S);
             }
             
             break;
         case (BusReqType::BusRdX):
+        case (BusReqType::BusAtomic):
             // if write
-            printf("req type: BusRDX\n");
-            system->record_invalidation();
-            line.state = LineState::I;
+            printf("req type: %s\n", req.type == BusReqType::BusRdX ? "BusRDX" : "BusATOMIC");
+            system->record_invalidation(cache_id, req.addr);
+            set_state(line, req.addr, LineState::I);
             break;
         case (BusReqType::BusUpgr):
             printf("req type: BusUPGR\n");
             // telling you to upgrade
-            if (line.state == LineState::S){
-                system->record_invalidation();
-                line.state = LineState::I;
+            if (is_shared_copy(line.state)){
+                system->record_invalidation(cache_id, req.addr);
+                set_state(line, req.addr, LineState::I);
             }
             break;
+        case (BusReqType::BusUpd): {
+            printf("req type: BusUPD\n");
+            if (update_limit && ++line.unused_updates >= update_limit) {
+                // competitive update: stop paying for a copy nobody here reads
+                system->record_update_fallback(cache_id);
+                system->record_invalidation(cache_id, req.addr);
+                set_state(line, req.addr, LineState::I);
+                result.had_line = false; // not a sharer after this grant
+                break;
+            }
+            uint32_t off = req.addr % LINE_SIZE;
+            fill_bytes(&line.data[off], req.data, req.size);
+            // a word updated twice without a read wasted the first update
+            uint8_t words = word_mask(off, req.size);
+            for (uint8_t w = words; w; w &= w - 1) {
+                system->record_update_delivered(cache_id, (line.unread_words & w & -w) != 0);
+            }
+            line.unread_words |= words;
+            // the writer takes over ownership of dirty data
+            if (line.state != LineState::S) set_state(line, req.addr, LineState::S);
+            break;
+        }
     }
     return result;
 }
@@ -178,37 +265,46 @@ void Cache::on_bus_grant(const BusGrant& grant){
     if (grant.req.cache_id != cache_id) return;
 
     waiting_for_bus = false;
-    wait_cycles = 5;
+    wait(grant.latency);
+    if (grant.req.type == BusReqType::BusAtomic){
+        perform_far_atomic(lines[index(grant.req.addr)], grant);
+        return;
+    }
 
     uint32_t idx = index(grant.req.addr);
     CacheLine& line = lines[idx];
     uint32_t new_tag = tag(grant.req.addr);
 
     // HANDLE EVICTION
-    bool RD_or_RDX = (grant.req.type == BusReqType::BusRd) || (grant.req.type == BusReqType::BusRdX);
+    // a BusUpd also fills the line when the store missed
+    bool present = line.state != LineState::I && line.tag == new_tag;
+    bool RD_or_RDX = (grant.req.type == BusReqType::BusRd) || (grant.req.type == BusReqType::BusRdX)
+                  || (grant.req.type == BusReqType::BusUpd && !present);
 
 
     if (line.state != LineState::I && line.tag != new_tag){
-        if (line.state == LineState::M){
-            constexpr uint32_t OFFSET_BITS = 5; // log2(32)
-            constexpr uint32_t INDEX_BITS  = 5; // log2(32)
-            uint32_t evict_addr =
-                (line.tag << (INDEX_BITS + OFFSET_BITS)) |
-                (idx      << OFFSET_BITS);
+        constexpr uint32_t OFFSET_BITS = 5; // log2(32)
+        constexpr uint32_t INDEX_BITS  = 5; // log2(32)
+        uint32_t evict_addr =
+            (line.tag << (INDEX_BITS + OFFSET_BITS)) |
+            (idx      << OFFSET_BITS);
 
-            printf("[Cache %d] EVICT: idx=%u old_tag=0x%x state=M -> writeback addr=0x%x\n",
-                cache_id, idx, line.tag, evict_addr);
+        if (is_dirty(line.state)){
+            printf("[Cache %d] EVICT: idx=%u old_tag=0x%x state=%c -> writeback addr=0x%x\n",
+                cache_id, idx, line.tag, state_letter(line.state), evict_addr);
 
             memory->write_line(evict_addr, line.data.data());
 
         } else {
-            printf("[Cache %d] EVICT: idx=%u old_tag=0x%x state!=M -> no writeback\n",
+            printf("[Cache %d] EVICT: idx=%u old_tag=0x%x clean -> no writeback\n",
                 cache_id, idx, line.tag);
         }
+        system->record_eviction(cache_id, evict_addr, is_dirty(line.state));
+        if (line.migrated) system->record_migratory_mispredict(cache_id, evict_addr);
 
         // invalidate old line
 
-        line.state = LineState::I;
+        set_state(line, evict_addr, LineState::I);
     }
     
     
@@ -221,33 +317,132 @@ void Cache::on_bus_grant(const BusGrant& grant){
     // HANDLE LINE STATE
     if (grant.req.type == BusReqType::BusRd){
         printf("[Cache %d] recieves BusRd\n", cache_id);
-        line.state = grant.shared ? LineState::S : LineState::E;
+        LineState shared = protocol == Protocol::MESIF ? LineState::F : LineState::S;
+        if (grant.req.exclusive) {
+            // an owner that kept dirty data (MOESI) hands it on dirty
+            set_state(line, grant.req.addr, grant.flush && has_owner(protocol) ? LineState::M : LineState::E);
+            line.migrated = true;
+        } else {
+            set_state(line, grant.req.addr, grant.shared ? shared : LineState::E);
+        }
     }
     if (grant.req.type == BusReqType::BusRdX){
 
-        uint32_t off = current_op.addr % LINE_SIZE;
-        line.data[off] = (uint8_t)current_op.data;
+        perform_store(line);
         printf("[Cache %d] recieves BusRdx\n", cache_id);
   
-        line.state = LineState::M;
+        set_state(line, grant.req.addr, LineState::M);
     }
     if (grant.req.type == BusReqType::BusUpgr){ 
         printf("[Cache %d] recieves BusUpgr\n", cache_id);
-        // already has S
-        if (!(line.tag == new_tag && line.state == LineState::S)) {
-            printf("[Cache %d] ERROR: BusUpgr but line not in S (tag=0x%x new_tag=0x%x state=%d)\n", cache_id, line.tag, new_tag, (int)line.state);
-            exit(1);
+        // already has S (or O/F)
+        if (!(line.tag == new_tag && is_shared_copy(line.state))) {
+            // the copy to upgrade is gone: report it and leave the line alone
+            system->record_protocol_error(cache_id, grant.req.addr, "BusUpgr granted without an S/O/F copy");
+            return;
         }
-        uint32_t off = current_op.addr % LINE_SIZE;
-        line.data[off] = (uint8_t)current_op.data;
-        line.state = LineState::M;
+        perform_store(line);
+        set_state(line, grant.req.addr, LineState::M);
+    }
+    if (grant.req.type == BusReqType::BusUpd){
+        printf("[Cache %d] recieves BusUpd\n", cache_id);
+        perform_store(line);
+        // Dragon's writer owns the dirty line (Sm); Firefly wrote it through
+        LineState shared = protocol == Protocol::DRAGON ? LineState::O : LineState::S;
+        set_state(line, grant.req.addr, grant.shared ? shared : LineState::M);
     }
-    // make line available
-    line.tag = new_tag;
 }
 
 
 // HELPER COMMANDS
+// every line state change goes through here so the shadow directory
+// in System sees it
+void Cache::set_state(CacheLine& line, uint32_t addr, LineState s){
+    bool present = line.state != LineState::I && line.tag == tag(addr);
+    if (!present || s == LineState::I) {
+        drop_updates(line);
+        line.migrated = false;
+    }
+    char from = present ? state_letter(line.state) : 'I';
+    line.tag = tag(addr);
+    line.state = s;
+    system->record_state_change(cache_id, addr, from, state_letter(s));
+}
+
+// write the current store (or atomic) into the line and make it globally visible
+void Cache::perform_store(CacheLine& line){
+    perform_rmw(&line.data[current_op.addr % LINE_SIZE]);
+}
+
+// apply the current op to the bytes it covers; an atomic's read half is
+// kept for completion
+void Cache::perform_rmw(uint8_t* bytes){
+    if (is_atomic(current_op.type)) {
+        atomic_old = load_value(bytes, current_op.size);
+        system->record_atomic_performed(cache_id, current_op, atomic_old);
+        uint64_t v;
+        if (!op_result(current_op, atomic_old, v)) return;
+        fill_bytes(bytes, v, current_op.size);
+    } else {
+        fill_bytes(bytes, current_op.data, current_op.size);
+    }
+    system->record_store_performed(cache_id, current_op.addr, bytes, current_op.size);
+}
+
+// the snoop dropped every other copy; memory performs the op and this
+// cache keeps none either
+void Cache::perform_far_atomic(CacheLine& line, const BusGrant& grant){
+    printf("[Cache %d] recieves BusAtomic\n", cache_id);
+    bool present = line.state != LineState::I && line.tag == tag(grant.req.addr);
+    // a dirty copy here (MOESI O) is newer than memory
+    uint8_t buf[LINE_SIZE];
+    memcpy(buf, present && is_dirty(line.state) ? line.data.data() : grant.data, LINE_SIZE);
+    uint32_t off = grant.req.addr % LINE_SIZE;
+    perform_rmw(&buf[off]);
+    memory->write_line(grant.req.addr, buf);
+    if (present) set_state(line, grant.req.addr, LineState::I);
+}
+
+// a load or store hit here: updates to the line were worth keeping, and
+// the first store to a migratory grant needs no upgrade
+void Cache::local_access(CacheLine& line, const MemOp& op){
+    if (line.migrated && op.type != OpType::LOAD) {
+        line.migrated = false;
+        system->record_upgrade_avoided(cache_id);
+    }
+    line.unused_updates = 0;
+    uint8_t words = line.unread_words & word_mask(op.addr % LINE_SIZE, op.size);
+    line.unread_words &= ~words;
+    for (int n = __builtin_popcount(words); n > 0; n--) {
+        system->record_update_read(cache_id, op.type != OpType::STORE);
+    }
+}
+
+// the copy goes away (or is refilled): pending updates were never read
+void Cache::drop_updates(CacheLine& line){
+    if (line.unread_words) system->record_updates_dropped(cache_id, __builtin_popcount(line.unread_words));
+    line.unread_words = 0;
+    line.unused_updates = 0;
+}
+
+char Cache::state_letter(LineState s){
+    switch (s){
+        case LineState::S: return 'S';
+        case LineState::E: return 'E';
+        case LineState::M: return 'M';
+        case LineState::O: return 'O';
+        case LineState::F: return 'F';
+        case LineState::I: return 'I';
+    }
+    return '?';
+}
+
+// finish the current op `cycles` from now; System only steps us when due
+void Cache::wait(int cycles){
+    ready_at = system->now() + cycles;
+    system->schedule_cache(cache_id, ready_at);
+}
+
 bool Cache::is_busy() const {
     return busy;
 }
@@ -265,6 +460,8 @@ void Cache::print_cache(){
                 case LineState::S: printf("S"); break;
                 case LineState::E: printf("E"); break;
                 case LineState::M: printf("M"); break;
+                case LineState::O: printf("O"); break;
+                case LineState::F: printf("F"); break;
             }
             printf(" data=");
             for (int j = 0; j < LINE_SIZE; j++) {
@@ -277,6 +474,13 @@ void Cache::print_cache(){
 int Cache::id(){
     return cache_id;
 }
+char Cache::victim_for(uint32_t addr){
+    CacheLine& line = lines[index(addr)];
+    if (line.state == LineState::I || line.tag == tag(addr))
+        return 'I';
+    return state_letter(line.state);
+}
+
 char Cache::state_for(uint32_t addr){
     uint32_t idx = index(addr);
     uint32_t t = tag(addr);
@@ -285,11 +489,5 @@ char Cache::state_for(uint32_t addr){
     if (line.state == LineState::I || line.tag != t)
         return 'I';
 
-    switch (line.state){
-        case LineState::S: return 'S';
-        case LineState::E: return 'E';
-        case LineState::M: return 'M';
-        case LineState::I: return 'I';
-    }
-    return '?';
+    return state_letter(line.state);
 }
\ No newline at end of file
@@ -4,23 +4,36 @@
 #include <cstdint>
 #include "core.hpp"
 #include "bus.hpp"
+#include "latency.hpp"
+#include "protocol.hpp"
 #include "system.hpp"
 #include <array>
 struct SnoopResult {
-    bool had_line = false;   // line existed in S/E/M
-    bool was_dirty = false;  // line was in M
+    bool had_line = false;   // line existed in any valid state
+    bool was_dirty = false;  // line was in M or O
+    bool forwards = false;   // clean copy that supplies the data (MESIF F, or E)
     const uint8_t* data = nullptr; 
 };
 
 class Memory;
 class System;
 class Cache {
+    friend class ModelChecker;
 public:
     
     Cache(int id, Bus* bus_, Memory* mem_, System* system); // each cache has access to main bus and memory
 
     void step();
 
+    // set before the first op; all caches of a System run the same one
+    void set_protocol(Protocol p) { protocol = p; }
+    // competitive update: a copy that received k updates without a local
+    // access is invalidated instead; 0 keeps updating forever
+    void set_update_limit(uint32_t k) { update_limit = k; }
+    // atomics that would need a bus transaction go to memory (BusAtomic)
+    // instead of taking the line in M
+    void set_far_atomics(bool on) { far_atomics = on; }
+
     bool accept_request(Core* core, const MemOp& op);
     void on_bus_event(const BusRequest& req);
     SnoopResult snoop_and_update(const BusRequest& req);
@@ -29,8 +42,21 @@ public:
     // helpers + validation
     void print_cache();
     char state_for(uint32_t addr);
+    // state of the line a miss on addr would evict, 'I' if none
+    char victim_for(uint32_t addr);
     bool is_busy() const;
+    uint64_t ready_cycle() const { return ready_at; }
     int id();
+
+    // calls f(line_addr, state letter) for every valid line
+    template <class F>
+    void for_each_line(F f) const {
+        for (uint32_t i = 0; i < NUM_LINES; i++) {
+            const CacheLine& line = lines[i];
+            if (line.state == LineState::I) continue;
+            f((line.tag * NUM_LINES + i) * LINE_SIZE, state_letter(line.state));
+        }
+    }
 private:
 
     System* system;
@@ -42,32 +68,66 @@ private:
     int cache_id; 
 
     bool busy;
-    int wait_cycles;
+    uint64_t ready_at; // cycle at which the current op completes
+
+    Protocol protocol = Protocol::MESI;
+    uint32_t update_limit = 0;
+    bool far_atomics = false;
 
     Core* owner_core;
     MemOp current_op;
 
+    // latency tracking for the in-flight op
+    uint64_t issue_cycle = 0;
+    bool issue_hit = false;
+    LatencyReq issue_req = LatencyReq::None;
+    uint64_t atomic_old = 0; // read half of the in-flight atomic, once performed
+
     static constexpr int LINE_SIZE = 32;
     static constexpr int NUM_LINES = 32;
     
-    // defines modified, exclusive, shared, and invalid
+    // defines modified, exclusive, shared, and invalid, plus the MOESI
+    // owned state (dirty, other caches may hold S copies) and the MESIF
+    // forward state (clean S copy that answers BusRd)
     enum class LineState {
         I,
         S,
         E,
-        M
+        M,
+        O,
+        F
     };
 
+    // write-update bookkeeping is per WORD_SIZE word
+    static constexpr int WORD_SIZE = 4;
+
     struct CacheLine {
         uint32_t tag;
         LineState state;
         std::array<uint8_t, LINE_SIZE> data;
+        uint16_t unused_updates = 0; // updates received since the last local access
+        uint8_t unread_words = 0;    // words updated remotely and not read here yet
+        bool migrated = false;       // granted exclusively on a load, not written yet
 
         CacheLine() : tag(0), state(LineState::I) {}
     };
     std::array<CacheLine, NUM_LINES> lines;
 
     // helpers
+    void wait(int cycles);
+    void set_state(CacheLine& line, uint32_t addr, LineState s);
+    void perform_store(CacheLine& line);
+    void perform_rmw(uint8_t* bytes);
+    void perform_far_atomic(CacheLine& line, const BusGrant& grant);
+    void local_access(CacheLine& line, const MemOp& op);
+    void drop_updates(CacheLine& line);
+    static char state_letter(LineState s);
+    static uint8_t word_mask(uint32_t off, int size);
+    static bool is_dirty(LineState s) { return s == LineState::M || s == LineState::O; }
+    // readable, but a store needs BusUpgr
+    static bool is_shared_copy(LineState s) {
+        return s == LineState::S || s == LineState::O || s == LineState::F;
+    }
     uint32_t line_addr(uint32_t addr) const {
         return addr & ~(LINE_SIZE - 1);
     }
@@ -0,0 +1,107 @@
+// coherence_check.cpp
+#include "coherence_check.hpp"
+#include "cache.hpp"
+#include "config.hpp"
+#include "log.hpp"
+#include <cassert>
+#include <cstdlib>
+#include <unordered_map>
+
+CoherenceChecker::CoherenceChecker(uint32_t mem_bytes)
+    : lines(mem_bytes / LINE_SIZE)
+{}
+
+uint16_t& CoherenceChecker::slot(LineCounts& c, char state){
+    switch (state) {
+        case 'M': return c.m;
+        case 'E': return c.e;
+        case 'S': return c.s;
+        case 'O': return c.o;
+        case 'F': return c.f;
+    }
+    assert(false);
+    return c.s;
+}
+
+void CoherenceChecker::check(const LineCounts& c, uint32_t addr, int cache_id){
+    const char* what = nullptr;
+    if      (c.m > 1)               what = "multiple M copies";
+    else if (c.e > 1)               what = "multiple E copies";
+    else if (c.m && c.e)            what = "E and M both present";
+    else if (c.o > 1)               what = "multiple O copies";
+    else if ((c.m || c.e) && c.s)   what = "S alongside an M/E copy";
+    else if ((c.m || c.e) && c.o)   what = "O alongside an M/E copy";
+    else if (c.f > 1)               what = "multiple F copies";
+    else if ((c.m || c.e) && c.f)   what = "F alongside an M/E copy";
+    else if (c.o && c.f)            what = "O and F both present";
+    if (!what) return;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "MESI VIOLATION: %s at addr 0x%x (after cache %d; M=%u E=%u S=%u O=%u F=%u)",
+        what, addr, cache_id, c.m, c.e, c.s, c.o, c.f);
+    violation(msg);
+}
+
+void CoherenceChecker::report(int cache_id, uint32_t addr, const char* what){
+    char msg[160];
+    snprintf(msg, sizeof(msg), "MESI VIOLATION: %s at addr 0x%x (cache %d)", what, addr, cache_id);
+    violation(msg);
+}
+
+void CoherenceChecker::violation(const char* msg){
+    if (fatal) {
+        fprintf(stderr, "%s\n", msg);
+        exit(1);
+    }
+    if (num_violations++ == 0) first_error = msg;
+}
+
+void CoherenceChecker::on_transition(int cache_id, uint32_t addr, char from, char to){
+    if (from == to) return;
+    uint32_t line = addr / LINE_SIZE;
+    assert(line < lines.size());
+    LineCounts& c = lines[line];
+    num_transitions++;
+
+    if (from != 'I') {
+        uint16_t& n = slot(c, from);
+        assert(n > 0);
+        n--;
+    }
+    if (to != 'I') slot(c, to)++;
+    check(c, line * LINE_SIZE, cache_id);
+}
+
+CoherenceChecker::LineCounts CoherenceChecker::counts(uint32_t addr) const {
+    uint32_t line = addr / LINE_SIZE;
+    assert(line < lines.size());
+    return lines[line];
+}
+
+void CoherenceChecker::full_scan(const std::vector<Cache*>& caches){
+    num_scans++;
+    std::unordered_map<uint32_t, LineCounts> seen;
+    for (Cache* cache : caches) {
+        cache->for_each_line([&](uint32_t addr, char state) {
+            LineCounts& c = seen[addr / LINE_SIZE];
+            slot(c, state)++;
+            check(c, addr, cache->id());
+        });
+    }
+
+    // every shadow entry must match what the caches actually hold
+    for (uint32_t line = 0; line < lines.size(); line++) {
+        const LineCounts& shadow = lines[line];
+        auto it = seen.find(line);
+        LineCounts real = it == seen.end() ? LineCounts{} : it->second;
+        if (shadow.m != real.m || shadow.e != real.e || shadow.s != real.s
+            || shadow.o != real.o || shadow.f != real.f) {
+            char msg[240];
+            snprintf(msg, sizeof(msg), "MESI VIOLATION: shadow directory out of sync at addr 0x%x "
+                "(shadow M=%u E=%u S=%u O=%u F=%u, caches M=%u E=%u S=%u O=%u F=%u)",
+                line * LINE_SIZE, shadow.m, shadow.e, shadow.s, shadow.o, shadow.f,
+                real.m, real.e, real.s, real.o, real.f);
+            violation(msg);
+        }
+    }
+}
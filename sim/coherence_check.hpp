@@ -0,0 +1,61 @@
+#ifndef COHERENCE_CHECK_HPP
+#define COHERENCE_CHECK_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Cache;
+
+// Shadow directory of per-line M/E/S/O/F copy counts. Caches report every line
+// state change, so the single-writer invariants are checked in O(1) at the
+// transition that breaks them rather than by polling every cache.
+class CoherenceChecker {
+public:
+    struct LineCounts {
+        uint16_t m = 0;
+        uint16_t e = 0;
+        uint16_t s = 0;
+        uint16_t o = 0;
+        uint16_t f = 0;
+    };
+
+    explicit CoherenceChecker(uint32_t mem_bytes);
+
+    // from/to use the state_for() letters 'M', 'E', 'S', 'O', 'F', 'I'
+    void on_transition(int cache_id, uint32_t addr, char from, char to);
+
+    // paranoid mode: after every bus grant, rebuild the directory from the
+    // caches and compare it with the shadow line by line
+    void set_paranoid(bool on) { paranoid = on; }
+    bool is_paranoid() const { return paranoid; }
+    void full_scan(const std::vector<Cache*>& caches);
+
+    // a cache met a grant its line state cannot explain
+    void report(int cache_id, uint32_t addr, const char* what);
+
+    // a violation exits the process unless fatal is off; then it is
+    // counted and the first report is kept
+    void set_fatal(bool on) { fatal = on; }
+    uint64_t violations() const { return num_violations; }
+    const std::string& first_violation() const { return first_error; }
+
+    LineCounts counts(uint32_t addr) const;
+    uint64_t transitions() const { return num_transitions; }
+    uint64_t scans() const { return num_scans; }
+
+private:
+    std::vector<LineCounts> lines; // indexed by addr / LINE_SIZE
+    bool paranoid = false;
+    bool fatal = true;
+    uint64_t num_violations = 0;
+    std::string first_error;
+    uint64_t num_transitions = 0;
+    uint64_t num_scans = 0;
+
+    static uint16_t& slot(LineCounts& c, char state);
+    void check(const LineCounts& c, uint32_t addr, int cache_id);
+    void violation(const char* msg);
+};
+
+#endif
@@ -1,4 +1,8 @@
 #pragma once
 #include <cstdint>
+#include <cstddef>
 
-static constexpr uint32_t LINE_SIZE = 32;
\ No newline at end of file
+static constexpr uint32_t LINE_SIZE = 32;
+
+// host cache line, used to pad per-core state against false sharing
+static constexpr size_t HOST_CACHE_LINE = 64;
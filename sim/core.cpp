@@ -1,8 +1,11 @@
 // core.cpp
 #include "core.hpp"
+#include <cassert>
+#include <cstring>
 #include <iostream>
 #include "log.hpp"
 #include "system.hpp"
+#include "workload.hpp"
 Core::Core(int id, System* system)
     : core_id(id), pc(0), stalled(false), system(system)
 {}
@@ -11,27 +14,102 @@ void Core::clear_trace() {
     trace.clear();
     pc = 0;
     stalled = false;
+    compute_started = false;
+    piece = 0;
+    system->update_core(core_id);
 }
 
-void Core::add_op(OpType type, uint32_t addr, uint32_t data) {
-    trace.push_back({type, addr, data});
+const char* op_type_name(OpType t) {
+    switch (t) {
+        case OpType::LOAD:      return "LOAD";
+        case OpType::STORE:     return "STORE";
+        case OpType::CAS:       return "CAS";
+        case OpType::FETCH_ADD: return "FETCH_ADD";
+        case OpType::SWAP:      return "SWAP";
+        case OpType::TAS:       return "TAS";
+        case OpType::COMPUTE:   return "COMPUTE";
+    }
+    return "?";
 }
 
-// is merely a placeholder
-void Core::step(){
-    if (stalled) return;
+bool op_result(const MemOp& op, uint64_t old, uint64_t& out) {
+    uint64_t mask = op.size >= 8 ? ~0ull : (1ull << (8 * op.size)) - 1;
+    switch (op.type) {
+        case OpType::CAS:
+            if (old != (op.expected & mask)) return false;
+            out = op.data & mask;
+            return true;
+        case OpType::FETCH_ADD: out = (old + op.data) & mask; return true;
+        case OpType::TAS:       out = 1; return true;
+        case OpType::LOAD:
+        case OpType::COMPUTE:   return false;
+        default:                out = op.data & mask; return true;
+    }
+}
+
+// the part of a line-crossing op in line `part` (0 first, 1 second)
+static MemOp line_piece(const MemOp& op, int part) {
+    uint32_t first = LINE_SIZE - op.addr % LINE_SIZE;
+    if (part == 0) return MemOp{op.type, op.addr, op.data, op.expected, (uint8_t)first};
+    // the second line starts at byte `first` of the data
+    uint32_t rot = 8 * (first % 8);
+    uint64_t data = rot ? op.data >> rot | op.data << (64 - rot) : op.data;
+    return MemOp{op.type, op.addr + first, data, op.expected, (uint8_t)(op.size - first)};
+}
+
+static void check_op(const MemOp& op) {
+    assert(op.type == OpType::COMPUTE || (op.size >= 1 && op.size <= LINE_SIZE));
+    assert(!(is_atomic(op.type) && (op.size > 8 || crosses_line(op))));
+}
+
+void Core::set_workload(Workload* w) {
+    workload = w;
+    has_pending = false;
+    compute_started = false;
+    piece = 0;
+    refill();
+    system->update_core(core_id);
+}
+
+// ask the workload for the next op once the previous one completed
+void Core::refill() {
+    if (workload && !has_pending) {
+        has_pending = workload->next(core_id, pending);
+        if (has_pending) check_op(pending);
+    }
+}
+
+void Core::add_op(OpType type, uint32_t addr, uint64_t data, uint64_t expected, uint8_t size) {
+    trace.push_back({type, addr, data, expected, size});
+    check_op(trace.back());
+    if (trace.size() == pc + 1) system->update_core(core_id);
+}
 
-    if (pc >= trace.size()) return;
+// only computing cores are stepped: a COMPUTE op retires compute_ipc
+// instructions a cycle, and the next op issues the cycle after the last
+void Core::step(){
+    if (!is_computing()) return;
 
-    MemOp op = trace[pc];
+    if (!compute_started) {
+        compute_left = whole_op().data;
+        compute_started = true;
+    }
+    // the last cycle's retire may overshoot below zero
+    if (compute_left > 0) {
+        compute_left -= system->get_compute_ipc();
+        return;
+    }
+    compute_started = false;
+    notify_complete();
 }
 
 bool Core::has_request() const {
-    return (!stalled && pc < trace.size());
+    return !stalled && !is_finished();
 }
 
 MemOp Core::current_op() const {
-    return trace[pc];
+    const MemOp& op = whole_op();
+    return crosses_line(op) ? line_piece(op, piece) : op;
 }
 int Core::trace_size() const {
     return trace.size();
@@ -39,29 +117,86 @@ int Core::trace_size() const {
 
 void Core::stall() {
     stalled = true;
+    system->update_core(core_id);
 }
 
 bool Core::is_stalled() const {
     return stalled;
 }
 bool Core::is_finished() const {
-    return pc >= trace.size();;
+    return workload ? !has_pending : pc >= trace.size();
+}
+bool Core::is_computing() const {
+    return !stalled && !is_finished() && whole_op().type == OpType::COMPUTE;
+}
+
+void Core::record_transaction(bool hit, LatencyReq req, uint64_t issue_cycle){
+    const MemOp& op = whole_op();
+    if (crosses_line(op)) {
+        if (piece == 0) {
+            split_issue = issue_cycle;
+            split_hit = hit;
+            split_req = req;
+            return;
+        }
+        // from the first accept; a hit only if both lines hit, and the
+        // first bus request names the row
+        issue_cycle = split_issue;
+        hit = hit && split_hit;
+        if (split_req != LatencyReq::None) req = split_req;
+    }
+    system->record_latency(core_id, op, hit, req, system->now() - issue_cycle);
 }
 
-void Core::notify_complete(uint32_t load_data){
-    if (pc < trace.size()) {
-        system->record_instruction_retired();
-        if (trace[pc].type == OpType::LOAD) {
+// golden-checks the bytes and collects them; the op completes once every
+// line it spans has been read
+void Core::notify_load(const uint8_t* bytes){
+    MemOp op = current_op();
+    const MemOp& whole = whole_op();
+    system->check_load(core_id, op.addr, bytes, op.size);
+    memcpy(load_buf.data() + (op.addr - whole.addr), bytes, op.size);
+    notify_complete(load_value(load_buf.data(), whole.size));
+}
+
+void Core::notify_complete(uint64_t load_data){
+    if (!is_finished()) {
+        MemOp op = whole_op();
+        if (crosses_line(op) && piece == 0) {
+            // first line done, the second issues next
+            piece = 1;
+            stalled = false;
+            system->update_core(core_id);
+            return;
+        }
+        piece = 0;
+        system->record_instruction_retired(core_id, op);
+        if (op.type == OpType::COMPUTE) {
+            printf("Core: %i, COMPUTE complete, instructions: %llu\n", core_id, (unsigned long long)op.data);
+        } else if (op.type == OpType::LOAD) {
     
             // for validation
-            last_load_addr  = trace[pc].addr;
+            last_load_addr  = op.addr;
             last_load_value = load_data;
             has_load_value  = true;
-            printf("Core: %i, LOAD complete, data: %d\n", core_id, load_data);
+            last_load_bytes = load_buf;
+            printf("Core: %i, LOAD complete, data: %llu\n", core_id, (unsigned long long)load_data);
+        } else if (is_atomic(op.type)) {
+            // checked against golden memory when it performed
+            last_load_addr  = op.addr;
+            last_load_value = load_data;
+            has_load_value  = true;
+            fill_bytes(last_load_bytes.data(), load_data, op.size);
+            printf("Core: %i, %s complete, old: %llu\n", core_id, op_type_name(op.type), (unsigned long long)load_data);
         } else {
-            printf("Core: %i, STORE complete, data: %d\n", core_id, load_data);
+            printf("Core: %i, STORE complete, data: %llu\n", core_id, (unsigned long long)load_data);
+        }
+        if (workload) {
+            has_pending = false;
+            workload->complete(core_id, op, load_data);
         }
     }
     stalled = false;
-    pc++;
-}
\ No newline at end of file
+    if (workload) refill();
+    else          pc++;
+    system->update_core(core_id);
+}
@@ -1,45 +1,99 @@
 #ifndef CORE_HPP
 #define CORE_HPP
 
+#include <array>
 #include <cstdint>
 #include <vector>
+#include "config.hpp"
+#include "latency.hpp"
 #include "system.hpp"
 
 class System;
+class Workload;
 
 enum class OpType {
     LOAD,
-    STORE
+    STORE,
+    // atomic read-modify-writes on the size bytes at addr, performed with
+    // the line in M (or at memory with far atomics); they return the old value
+    CAS,        // write data if the value equals expected
+    FETCH_ADD,  // add data
+    SWAP,       // write data
+    TAS,        // write 1
+    // data non-memory instructions, retired by the core at the system's
+    // compute IPC without touching the cache
+    COMPUTE
 };
 
+// Accesses are size bytes at addr, little endian. Scalars are 1, 2, 4 or 8
+// bytes; 16 and 32 byte vector stores repeat data's 8 bytes across the
+// access. An access that crosses a line is issued as two transactions, one
+// per line; atomics must stay within one.
 struct MemOp {
     OpType type;
     uint32_t addr;
-    uint32_t data; //for store
+    uint64_t data; //for store
+    uint64_t expected = 0; // CAS compare value
+    uint8_t size = 4;
 };
 
+inline bool crosses_line(const MemOp& op) {
+    return op.type != OpType::COMPUTE && op.addr % LINE_SIZE + op.size > LINE_SIZE;
+}
+// little-endian value of the first min(size, 8) bytes
+inline uint64_t load_value(const uint8_t* bytes, int size) {
+    uint64_t v = 0;
+    for (int i = size < 8 ? size - 1 : 7; i >= 0; i--) v = v << 8 | bytes[i];
+    return v;
+}
+// writes size bytes of data, repeating its 8 bytes past the eighth
+inline void fill_bytes(uint8_t* bytes, uint64_t data, int size) {
+    for (int i = 0; i < size; i++) bytes[i] = (uint8_t)(data >> (8 * (i % 8)));
+}
+
+inline bool is_atomic(OpType t) { return t != OpType::LOAD && t != OpType::STORE && t != OpType::COMPUTE; }
+// statistics group of a memory op: 0 load, 1 store, 2 atomic
+inline int op_class(OpType t) { return t == OpType::LOAD ? 0 : (t == OpType::STORE ? 1 : 2); }
+const char* op_type_name(OpType t);
+// value an atomic leaves in size bytes holding `old`; false if it leaves
+// them alone (failed CAS)
+bool op_result(const MemOp& op, uint64_t old, uint64_t& out);
+
 class Core {
     public:
         Core(int id, System* system);
 
         void clear_trace();
-        void add_op(OpType type, uint32_t addr, uint32_t data = 0);
+        void add_op(OpType type, uint32_t addr, uint64_t data = 0, uint64_t expected = 0, uint8_t size = 4);
+        // pull ops from a closed-loop workload instead of the trace;
+        // nullptr goes back to the trace
+        void set_workload(Workload* w);
 
         void step();
-        void notify_complete(uint32_t load_data = 0);
+        void notify_complete(uint64_t load_data = 0);
+        // a load (or one line of it) read these op.size bytes
+        void notify_load(const uint8_t* bytes);
+        // the cache finished a transaction of the current op; latency is
+        // recorded once per op, when its last line completes
+        void record_transaction(bool hit, LatencyReq req, uint64_t issue_cycle);
 
+        // the transaction to issue: the op, or its part in one line
         MemOp current_op() const;
         
         // checkers
         void stall();
         bool is_stalled() const;
         bool is_finished() const;
+        bool is_computing() const; // retiring a COMPUTE op
         bool has_request() const;
         int trace_size() const;
 
+        // the last load, or the old value returned by the last atomic;
+        // the value holds its first 8 bytes, last_load_bytes all of them
         uint32_t last_load_addr  = 0;
-        uint32_t last_load_value = 0;
+        uint64_t last_load_value = 0;
         bool     has_load_value  = false;
+        std::array<uint8_t, LINE_SIZE> last_load_bytes = {};
 
     private:
         System* system;
@@ -48,6 +102,22 @@ class Core {
         std::vector<MemOp> trace;
         size_t pc;
         bool stalled;
+
+        Workload* workload = nullptr;
+        MemOp pending;             // workload op waiting to issue
+        bool has_pending = false;
+        void refill();
+
+        double compute_left = 0;   // instructions of the COMPUTE op still to retire
+        bool compute_started = false;
+        int piece = 0;             // which line of a line-crossing op is in flight
+        uint64_t split_issue = 0;  // the first line's accept, hit and request
+        bool split_hit = false;
+        LatencyReq split_req = LatencyReq::None;
+        std::array<uint8_t, LINE_SIZE> load_buf = {};
+
+        const MemOp& whole_op() const { return workload ? pending : trace[pc]; }
+
 };
 
 #endif
\ No newline at end of file
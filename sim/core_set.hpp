@@ -0,0 +1,64 @@
+#ifndef CORE_SET_HPP
+#define CORE_SET_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Fixed-size bitset over core ids with a maintained population count and
+// find-first-set search, so per-cycle scans cost O(cores / 64).
+class CoreSet {
+public:
+    void resize(int n) {
+        size = n;
+        words.assign((n + 63) / 64, 0);
+        pop = 0;
+    }
+
+    bool test(int i) const { return (words[i >> 6] >> (i & 63)) & 1u; }
+    int count() const { return pop; }
+    bool empty() const { return pop == 0; }
+
+    void set(int i) {
+        uint64_t bit = 1ull << (i & 63);
+        if (!(words[i >> 6] & bit)) { words[i >> 6] |= bit; pop++; }
+    }
+    void reset(int i) {
+        uint64_t bit = 1ull << (i & 63);
+        if (words[i >> 6] & bit) { words[i >> 6] &= ~bit; pop--; }
+    }
+    void assign(int i, bool v) { v ? set(i) : reset(i); }
+
+    // first member at or after `from`, wrapping around; -1 if empty
+    int find_next(int from) const {
+        if (pop == 0) return -1;
+        int nw = (int)words.size();
+        int w = from >> 6;
+        uint64_t cur = words[w] & (~0ull << (from & 63));
+        for (int step = 0; step <= nw; step++) {
+            if (cur) return (w << 6) + __builtin_ctzll(cur);
+            w = (w + 1 == nw) ? 0 : w + 1;
+            cur = words[w];
+        }
+        return -1;
+    }
+
+    // calls fn(i) for every member; fn may remove members while iterating
+    template <typename Fn>
+    void for_each(Fn fn) const {
+        for (size_t w = 0; w < words.size(); w++) {
+            uint64_t bits = words[w];
+            while (bits) {
+                int i = (int)(w << 6) + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                fn(i);
+            }
+        }
+    }
+
+private:
+    int size = 0;
+    int pop = 0;
+    std::vector<uint64_t> words;
+};
+
+#endif
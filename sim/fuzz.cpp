@@ -0,0 +1,332 @@
+// fuzz.cpp
+#include "fuzz.hpp"
+#include "core.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+
+// ---- TransitionCoverage ----
+
+int TransitionCoverage::state_index(char state){
+    switch (state) {
+        case 'I': return 0;
+        case 'S': return 1;
+        case 'E': return 2;
+        case 'M': return 3;
+        case 'O': return 4;
+        case 'F': return 5;
+    }
+    assert(false);
+    return 0;
+}
+
+static const char* fuzz_req_name(int req){
+    static const char* names[5] = {"BusRd", "BusRdX", "BusUpgr", "BusUpd", "BusAtomic"};
+    return names[req];
+}
+
+void TransitionCoverage::hit(uint32_t addr, int point){
+    counts[point]++;
+    auto it = last_point.find(addr / LINE_SIZE);
+    if (it == last_point.end()) {
+        last_point.emplace(addr / LINE_SIZE, point);
+    } else {
+        edges[it->second * NUM_POINTS + point]++;
+        it->second = point;
+    }
+}
+
+void TransitionCoverage::accept(uint32_t addr, char state, OpType op, char victim){
+    int v = victim == 'I' ? 0 : ((victim == 'M' || victim == 'O') ? 2 : 1);
+    hit(addr, (state_index(state) * NUM_OPS + op_class(op)) * 3 + v);
+}
+
+void TransitionCoverage::snoop(uint32_t addr, char state, BusReqType req){
+    hit(addr, ACCEPT_POINTS + state_index(state) * NUM_REQS + (int)req);
+}
+
+void TransitionCoverage::grant(uint32_t addr, BusReqType req, bool shared, bool from_peer){
+    hit(addr, ACCEPT_POINTS + SNOOP_POINTS + ((int)req * 2 + shared) * 2 + from_peer);
+}
+
+int TransitionCoverage::covered() const {
+    int n = 0;
+    for (uint64_t c : counts) n += c > 0;
+    return n;
+}
+
+int TransitionCoverage::edges_covered() const {
+    int n = 0;
+    for (uint64_t c : edges) n += c > 0;
+    return n;
+}
+
+bool TransitionCoverage::adds_to(const TransitionCoverage& seen) const {
+    for (int p = 0; p < NUM_POINTS; p++) {
+        if (counts[p] && !seen.counts[p]) return true;
+    }
+    for (int e = 0; e < NUM_EDGES; e++) {
+        if (edges[e] && !seen.edges[e]) return true;
+    }
+    return false;
+}
+
+void TransitionCoverage::merge(const TransitionCoverage& other){
+    for (int p = 0; p < NUM_POINTS; p++) counts[p] += other.counts[p];
+    for (int e = 0; e < NUM_EDGES; e++) edges[e] += other.edges[e];
+}
+
+std::string TransitionCoverage::point_name(int p){
+    static const char states[NUM_STATES] = {'I', 'S', 'E', 'M', 'O', 'F'};
+    char buf[64];
+    if (p < ACCEPT_POINTS) {
+        static const char* victims[3] = {"none", "clean", "dirty"};
+        static const char* ops[NUM_OPS] = {"LOAD", "STORE", "ATOMIC"};
+        snprintf(buf, sizeof(buf), "accept %c %s victim=%s",
+            states[p / (NUM_OPS * 3)], ops[(p / 3) % NUM_OPS], victims[p % 3]);
+    } else if (p < ACCEPT_POINTS + SNOOP_POINTS) {
+        p -= ACCEPT_POINTS;
+        snprintf(buf, sizeof(buf), "snoop  %c %s", states[p / NUM_REQS], fuzz_req_name(p % NUM_REQS));
+    } else {
+        p -= ACCEPT_POINTS + SNOOP_POINTS;
+        snprintf(buf, sizeof(buf), "grant  %s shared=%d peer=%d", fuzz_req_name(p / 4), (p / 2) % 2, p % 2);
+    }
+    return buf;
+}
+
+void TransitionCoverage::print_report(FILE* out) const {
+    fprintf(out, "transition coverage: %d / %d points (some are unreachable under any one protocol), %d edges\n",
+        covered(), NUM_POINTS, edges_covered());
+    for (int p = 0; p < NUM_POINTS; p++) {
+        fprintf(out, "  %-36s %12llu%s\n", point_name(p).c_str(),
+            (unsigned long long)counts[p], counts[p] ? "" : "  <- never reached");
+    }
+}
+
+// ---- generation ----
+
+static uint32_t fuzz_pick_addr(FuzzRng& rng, const FuzzConfig& cfg, uint32_t set_base, uint32_t tag_base){
+    uint32_t set = (set_base + rng.below((uint32_t)cfg.sets)) % 32;
+    uint32_t tag = tag_base + rng.below((uint32_t)cfg.tags_per_set);
+    // a few bytes per line, so cores also falsely share lines
+    return (tag * 32 + set) * LINE_SIZE + rng.below(4);
+}
+
+static FuzzOp fuzz_random_op(FuzzRng& rng, const FuzzConfig& cfg, int core, uint32_t addr){
+    uint8_t size = cfg.widths ? (uint8_t)(1u << rng.below(4)) : 1;
+    if (cfg.atomic_percent > 0 && (int)rng.below(100) < cfg.atomic_percent) {
+        static const OpType atomics[4] = {OpType::CAS, OpType::FETCH_ADD, OpType::SWAP, OpType::TAS};
+        // small compare values so CAS both succeeds and fails; aligned, so
+        // never split. Wide ops sometimes carry a full 64-bit operand, so
+        // adds carry across every byte
+        uint64_t data = cfg.widths && rng.below(2) ? rng.next() : 1 + rng.below(3);
+        return {core, atomics[rng.below(4)], addr & ~(uint32_t)(size - 1), data, rng.below(4), size};
+    }
+    // wide ops anywhere in the line, so some cross into the next one
+    if (cfg.widths) addr = addr - addr % LINE_SIZE + rng.below(LINE_SIZE);
+    bool store = (int)rng.below(100) < cfg.store_percent;
+    uint64_t data = cfg.widths ? rng.next() | 1 : 1 + rng.below(255);
+    return {core, store ? OpType::STORE : OpType::LOAD, addr, store ? data : 0, 0, size};
+}
+
+FuzzTrace fuzz_generate(FuzzRng& rng, const FuzzConfig& cfg){
+    FuzzTrace t;
+    t.protocol = cfg.protocol;
+    t.update_limit = cfg.update_limit;
+    t.migratory = cfg.migratory;
+    t.far_atomics = cfg.far_atomics;
+    t.num_cores = cfg.min_cores + (int)rng.below((uint32_t)(cfg.max_cores - cfg.min_cores + 1));
+    uint32_t set_base = rng.below(32);
+    uint32_t tag_base = 0x40 + rng.below(0x300);
+
+    for (int c = 0; c < t.num_cores; c++) {
+        int n = 1 + (int)rng.below((uint32_t)cfg.max_ops_per_core);
+        for (int k = 0; k < n; k++) {
+            t.ops.push_back(fuzz_random_op(rng, cfg, c, fuzz_pick_addr(rng, cfg, set_base, tag_base)));
+        }
+    }
+    return t;
+}
+
+FuzzTrace fuzz_mutate(const FuzzTrace& src, FuzzRng& rng, const FuzzConfig& cfg, const FuzzTrace* other){
+    FuzzTrace t = src;
+    // addresses already in the trace keep the mutant in the same sets
+    auto some_addr = [&]() {
+        return t.ops.empty() ? fuzz_pick_addr(rng, cfg, 0, 0x40)
+                             : t.ops[rng.below((uint32_t)t.ops.size())].addr;
+    };
+
+    int edits = 1 + (int)rng.below(4);
+    for (int e = 0; e < edits; e++) {
+        size_t n = t.ops.size();
+        size_t i = n ? rng.below((uint32_t)n) : 0;
+        switch (rng.below(7)) {
+            case 0: // retarget, sometimes to a neighbouring byte or conflicting tag
+                if (!n) break;
+                t.ops[i].addr = rng.below(2) ? some_addr()
+                                             : t.ops[i].addr ^ (rng.below(2) ? 1u : 32u * 32u);
+                if (is_atomic(t.ops[i].type)) t.ops[i].addr &= ~(uint32_t)(t.ops[i].size - 1);
+                break;
+            case 1: // flip load/store
+                if (!n) break;
+                t.ops[i] = fuzz_random_op(rng, cfg, t.ops[i].core, t.ops[i].addr);
+                break;
+            case 2: // insert
+                t.ops.insert(t.ops.begin() + (n ? rng.below((uint32_t)n + 1) : 0),
+                    fuzz_random_op(rng, cfg, (int)rng.below((uint32_t)t.num_cores), some_addr()));
+                break;
+            case 3: // delete
+                if (n > 1) t.ops.erase(t.ops.begin() + i);
+                break;
+            case 4: // move to another core
+                if (!n) break;
+                t.ops[i].core = (int)rng.below((uint32_t)t.num_cores);
+                break;
+            case 5: { // splice a run of ops from another corpus entry
+                if (!other || other->ops.empty()) break;
+                size_t from = rng.below((uint32_t)other->ops.size());
+                size_t len = 1 + rng.below(8);
+                for (size_t k = from; k < other->ops.size() && k < from + len; k++) {
+                    FuzzOp op = other->ops[k];
+                    op.core %= t.num_cores;
+                    t.ops.push_back(op);
+                }
+                break;
+            }
+            case 6: // grow or shrink the core count
+                if (rng.below(2) && t.num_cores < cfg.max_cores) {
+                    t.num_cores++;
+                } else if (t.num_cores > cfg.min_cores) {
+                    t.num_cores--;
+                    for (auto& op : t.ops) op.core %= t.num_cores;
+                }
+                break;
+        }
+    }
+    if (t.ops.empty()) t.ops.push_back(fuzz_random_op(rng, cfg, 0, some_addr()));
+    return t;
+}
+
+// ---- execution ----
+
+uint32_t fuzz_cycle_budget(const FuzzTrace& t){
+    // a fully serialized trace needs at most ~6 cycles per transaction;
+    // line-crossing ops take two
+    uint32_t n = 0;
+    for (const FuzzOp& op : t.ops) n += op.addr % LINE_SIZE + op.size > LINE_SIZE ? 2 : 1;
+    return 500 + 10 * n;
+}
+
+FuzzResult fuzz_run(const FuzzTrace& t, TransitionCoverage* cov){
+    System sys(t.num_cores);
+    sys.set_protocol(t.protocol);
+    sys.set_update_limit(t.update_limit);
+    sys.set_migratory_sharing(t.migratory);
+    sys.set_far_atomics(t.far_atomics);
+    sys.set_print_report(false);
+    sys.set_violations_fatal(false);
+    sys.attach_coverage(cov);
+    for (const FuzzOp& op : t.ops) {
+        sys.get_core(op.core)->add_op(op.type, op.addr, op.data, op.expected, op.size);
+    }
+    sys.run(fuzz_cycle_budget(t));
+
+    FuzzResult r;
+    r.cycles = sys.get_stats().cycles;
+    if (sys.has_violation()) {
+        r.kind = FuzzResult::Violation;
+        r.message = sys.violation_message();
+        return r;
+    }
+    for (int c = 0; c < t.num_cores; c++) {
+        Core* core = sys.get_core(c);
+        if (!core->is_finished() || core->is_stalled()) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "HANG: core %d not done after %llu cycles",
+                c, (unsigned long long)r.cycles);
+            r.kind = FuzzResult::Hang;
+            r.message = msg;
+            return r;
+        }
+    }
+    return r;
+}
+
+// ---- minimization ----
+
+FuzzTrace fuzz_minimize(const FuzzTrace& t, const std::function<bool(const FuzzTrace&)>& still_fails){
+    auto with_ops = [&](std::vector<FuzzOp> ops) {
+        FuzzTrace c = t;
+        c.ops = std::move(ops);
+        return c;
+    };
+
+    std::vector<FuzzOp> ops = t.ops;
+    size_t n = 2;
+    while (ops.size() >= 2) {
+        size_t chunk = (ops.size() + n - 1) / n;
+        bool reduced = false;
+
+        // try each chunk alone, then everything but each chunk
+        for (size_t start = 0; start < ops.size() && !reduced; start += chunk) {
+            size_t end = std::min(start + chunk, ops.size());
+            std::vector<FuzzOp> subset(ops.begin() + start, ops.begin() + end);
+            if (still_fails(with_ops(subset))) {
+                ops = std::move(subset);
+                n = 2;
+                reduced = true;
+            }
+        }
+        for (size_t start = 0; start < ops.size() && !reduced; start += chunk) {
+            size_t end = std::min(start + chunk, ops.size());
+            std::vector<FuzzOp> rest(ops.begin(), ops.begin() + start);
+            rest.insert(rest.end(), ops.begin() + end, ops.end());
+            if (still_fails(with_ops(rest))) {
+                ops = std::move(rest);
+                n = std::max<size_t>(n - 1, 2);
+                reduced = true;
+            }
+        }
+        if (!reduced) {
+            if (n >= ops.size()) break;
+            n = std::min(n * 2, ops.size());
+        }
+    }
+
+    FuzzTrace best = with_ops(ops);
+
+    // renumber the cores that still issue ops
+    std::vector<int> remap(t.num_cores, -1);
+    int used = 0;
+    for (const FuzzOp& op : ops) {
+        if (remap[op.core] < 0) remap[op.core] = used++;
+    }
+    if (used > 0 && used < t.num_cores) {
+        FuzzTrace compact = best;
+        compact.num_cores = used;
+        for (auto& op : compact.ops) op.core = remap[op.core];
+        if (still_fails(compact)) best = compact;
+    }
+    return best;
+}
+
+void fuzz_print_reproducer(FILE* out, const FuzzTrace& t, const FuzzResult& r){
+    fprintf(out, "// fuzz reproducer, %zu ops on %d cores\n", t.ops.size(), t.num_cores);
+    fprintf(out, "// %s\n", r.message.c_str());
+    fprintf(out, "System sys(%d);\n", t.num_cores);
+    if (t.protocol != Protocol::MESI) {
+        std::string name = protocol_name(t.protocol);
+        for (char& ch : name) ch = (char)toupper(ch);
+        fprintf(out, "sys.set_protocol(Protocol::%s);\n", name.c_str());
+    }
+    if (t.update_limit) fprintf(out, "sys.set_update_limit(%u);\n", t.update_limit);
+    if (t.migratory) fprintf(out, "sys.set_migratory_sharing(true);\n");
+    if (t.far_atomics) fprintf(out, "sys.set_far_atomics(true);\n");
+    for (const FuzzOp& op : t.ops) {
+        fprintf(out, "sys.get_core(%d)->add_op(OpType::%s, 0x%x, 0x%llxull, 0x%llxull, %u);\n", op.core,
+            op_type_name(op.type), op.addr, (unsigned long long)op.data, (unsigned long long)op.expected,
+            (unsigned)op.size);
+    }
+    fprintf(out, "sys.run(%u);\n", fuzz_cycle_budget(t));
+}
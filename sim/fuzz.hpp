@@ -0,0 +1,127 @@
+#ifndef FUZZ_HPP
+#define FUZZ_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bus.hpp"
+#include "protocol.hpp"
+
+enum class OpType;
+
+// Coherence transition coverage. Three kinds of points:
+//   accept: requester's line state x op class x victim state (none/clean/dirty)
+//   snoop:  snooper's line state x bus request type
+//   grant:  bus request type x shared x supplied by a peer cache
+// plus edges: pairs of consecutive points on the same line, which keep
+// steering generation after every reachable point has been seen.
+class TransitionCoverage {
+public:
+    static constexpr int NUM_STATES = 6; // I S E M O F
+    static constexpr int NUM_REQS = 5;
+    static constexpr int NUM_OPS = 3;    // load, store, atomic
+    static constexpr int ACCEPT_POINTS = NUM_STATES * NUM_OPS * 3;
+    static constexpr int SNOOP_POINTS = NUM_STATES * NUM_REQS;
+    static constexpr int GRANT_POINTS = NUM_REQS * 2 * 2;
+    static constexpr int NUM_POINTS = ACCEPT_POINTS + SNOOP_POINTS + GRANT_POINTS;
+    static constexpr int NUM_EDGES = NUM_POINTS * NUM_POINTS;
+
+    void accept(uint32_t addr, char state, OpType op, char victim);
+    void snoop(uint32_t addr, char state, BusReqType req);
+    void grant(uint32_t addr, BusReqType req, bool shared, bool from_peer);
+
+    uint64_t hits(int point) const { return counts[point]; }
+    uint64_t edge_hits(int edge) const { return edges[edge]; }
+    int covered() const;
+    int edges_covered() const;
+    // true if this run reached a point or edge that `seen` never has
+    bool adds_to(const TransitionCoverage& seen) const;
+    void merge(const TransitionCoverage& other);
+
+    static std::string point_name(int point);
+    void print_report(FILE* out) const;
+
+private:
+    std::array<uint64_t, NUM_POINTS> counts{};
+    std::vector<uint64_t> edges = std::vector<uint64_t>(NUM_EDGES, 0);
+    std::unordered_map<uint32_t, int> last_point; // per line, within one run
+
+    void hit(uint32_t addr, int point);
+    static int state_index(char state);
+};
+
+struct FuzzOp {
+    int core;
+    OpType type;
+    uint32_t addr;
+    uint64_t data;
+    uint64_t expected = 0; // CAS only
+    uint8_t size = 1;      // access width in bytes
+};
+
+// ops of all cores in one list; each core issues its own in list order
+struct FuzzTrace {
+    int num_cores = 2;
+    Protocol protocol = Protocol::MESI;
+    uint32_t update_limit = 0;
+    bool migratory = false;
+    bool far_atomics = false;
+    std::vector<FuzzOp> ops;
+};
+
+struct FuzzConfig {
+    int min_cores = 2;
+    int max_cores = 8;
+    int max_ops_per_core = 48;
+    int sets = 3;             // distinct cache sets in the address pool
+    int tags_per_set = 3;     // lines per set, > 1 forces conflict evictions
+    int store_percent = 45;
+    int atomic_percent = 0;   // of all ops, taken before the store/load split
+    Protocol protocol = Protocol::MESI;
+    uint32_t update_limit = 0;
+    bool migratory = false;
+    bool far_atomics = false;
+    bool widths = false;      // 1/2/4/8-byte ops at any offset, atomics aligned
+};
+
+// xorshift64*, one per worker so generation never shares state
+class FuzzRng {
+public:
+    explicit FuzzRng(uint64_t seed) : s(seed * 0x9e3779b97f4a7c15ull + 1) {}
+    uint64_t next() {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return s * 0x2545f4914f6cdd1dull;
+    }
+    uint32_t below(uint32_t n) { return (uint32_t)(next() % n); }
+
+private:
+    uint64_t s;
+};
+
+FuzzTrace fuzz_generate(FuzzRng& rng, const FuzzConfig& cfg);
+// small random edit; `other` (may be null) is a splice donor
+FuzzTrace fuzz_mutate(const FuzzTrace& t, FuzzRng& rng, const FuzzConfig& cfg, const FuzzTrace* other);
+
+struct FuzzResult {
+    enum Kind { Pass, Violation, Hang };
+    Kind kind = Pass;
+    std::string message;
+    uint64_t cycles = 0;
+};
+
+// runs the trace on a fresh System with violations recorded, not fatal
+FuzzResult fuzz_run(const FuzzTrace& t, TransitionCoverage* cov = nullptr);
+uint32_t fuzz_cycle_budget(const FuzzTrace& t);
+
+// ddmin over the op list: the smallest trace for which still_fails holds,
+// with unused cores dropped and the rest renumbered when that keeps it failing
+FuzzTrace fuzz_minimize(const FuzzTrace& t, const std::function<bool(const FuzzTrace&)>& still_fails);
+
+// the trace as C++ test code
+void fuzz_print_reproducer(FILE* out, const FuzzTrace& t, const FuzzResult& r);
+
+#endif
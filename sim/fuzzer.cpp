@@ -0,0 +1,186 @@
+// fuzzer.cpp
+// Parallel coverage-guided fuzzing of the coherence protocol. Every case is
+// a random multi-core trace run with the MESI checker and golden memory in
+// non-fatal mode; traces that reach new transition coverage join the corpus
+// and are mutated more often the rarer the points they cover.
+//
+//   g++ -O2 -pthread fuzzer.cpp -o fuzzer
+//   ./fuzzer                                  10000 cases on every hardware thread
+//   ./fuzzer --cases 200000 --threads 8 --seed 7
+//   ./fuzzer --max-cores 16 --max-ops 96 --coverage
+//
+// The first violation or hang stops the run; the failing trace is
+// delta-debugged to a minimal reproducer and written as test code.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "system.cpp"
+#include "log.cpp"
+
+struct CorpusEntry {
+    FuzzTrace trace;
+    TransitionCoverage cov;
+};
+
+struct FuzzState {
+    FuzzConfig cfg;
+    uint64_t cases = 10000;
+    uint64_t seed = 1;
+
+    std::atomic<uint64_t> next_case{0};
+    std::atomic<uint64_t> cases_run{0};
+    std::atomic<uint64_t> ops_run{0};
+    std::atomic<bool> stop{false};
+
+    std::mutex mu; // guards everything below
+    TransitionCoverage global;
+    std::vector<CorpusEntry> corpus;
+    std::vector<double> energy; // per corpus entry, refreshed every ENERGY_REFRESH cases
+    double energy_total = 0;
+    uint64_t merges_since_energy = 0;
+    bool failed = false;
+    uint64_t fail_case = 0;
+    FuzzTrace fail_trace;
+    FuzzResult fail_result;
+};
+
+static constexpr uint64_t ENERGY_REFRESH = 512;
+
+// entries covering rarely hit points and edges get proportionally more
+// mutations; the weights lag the global counts by up to ENERGY_REFRESH cases
+static size_t pick_parent(FuzzState& st, FuzzRng& rng) {
+    if (st.energy.size() != st.corpus.size() || st.merges_since_energy >= ENERGY_REFRESH) {
+        st.energy.assign(st.corpus.size(), 0.0);
+        st.energy_total = 0;
+        for (size_t i = 0; i < st.corpus.size(); i++) {
+            const TransitionCoverage& c = st.corpus[i].cov;
+            double e = 0;
+            for (int p = 0; p < TransitionCoverage::NUM_POINTS; p++) {
+                if (c.hits(p)) e += 1.0 / (double)st.global.hits(p);
+            }
+            for (int k = 0; k < TransitionCoverage::NUM_EDGES; k++) {
+                if (c.edge_hits(k)) e += 1.0 / (double)st.global.edge_hits(k);
+            }
+            st.energy[i] = e;
+            st.energy_total += e;
+        }
+        st.merges_since_energy = 0;
+    }
+
+    double x = (double)(rng.next() >> 11) * (1.0 / 9007199254740992.0) * st.energy_total;
+    for (size_t i = 0; i < st.energy.size(); i++) {
+        if (x < st.energy[i]) return i;
+        x -= st.energy[i];
+    }
+    return st.energy.size() - 1;
+}
+
+static void worker(FuzzState& st) {
+    while (!st.stop.load(std::memory_order_relaxed)) {
+        uint64_t i = st.next_case.fetch_add(1);
+        if (i >= st.cases) break;
+
+        FuzzRng rng(st.seed * 0x100000001b3ull + i);
+        FuzzTrace t;
+        bool mutated = false;
+        {
+            std::lock_guard<std::mutex> lock(st.mu);
+            if (!st.corpus.empty() && rng.below(100) < 75) {
+                const CorpusEntry& parent = st.corpus[pick_parent(st, rng)];
+                const CorpusEntry& donor = st.corpus[rng.below((uint32_t)st.corpus.size())];
+                t = fuzz_mutate(parent.trace, rng, st.cfg, &donor.trace);
+                mutated = true;
+            }
+        }
+        if (!mutated) t = fuzz_generate(rng, st.cfg);
+
+        TransitionCoverage cov;
+        FuzzResult r = fuzz_run(t, &cov);
+        st.cases_run++;
+        st.ops_run += t.ops.size();
+
+        std::lock_guard<std::mutex> lock(st.mu);
+        if (cov.adds_to(st.global)) st.corpus.push_back({t, cov});
+        st.global.merge(cov);
+        st.merges_since_energy++;
+        if (r.kind != FuzzResult::Pass && !st.failed) {
+            st.failed = true;
+            st.fail_case = i;
+            st.fail_trace = t;
+            st.fail_result = r;
+            st.stop = true;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    FuzzState st;
+    int threads = (int)std::thread::hardware_concurrency();
+    const char* out_path = "fuzz_repro.txt";
+    bool show_coverage = false;
+
+    for (int i = 1; i < argc; i++) {
+        if      (!strcmp(argv[i], "--cases") && i + 1 < argc)     st.cases = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)   threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)      st.seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--max-cores") && i + 1 < argc) st.cfg.max_cores = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-ops") && i + 1 < argc)   st.cfg.max_ops_per_core = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)       out_path = argv[++i];
+        else if (!strcmp(argv[i], "--coverage"))                  show_coverage = true;
+        else if (!strcmp(argv[i], "--protocol") && i + 1 < argc && parse_protocol(argv[i + 1], st.cfg.protocol)) i++;
+        else if (!strcmp(argv[i], "--update-limit") && i + 1 < argc) st.cfg.update_limit = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--migratory"))                   st.cfg.migratory = true;
+        else if (!strcmp(argv[i], "--atomics") && i + 1 < argc)     st.cfg.atomic_percent = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--far-atomics"))                 st.cfg.far_atomics = true;
+        else if (!strcmp(argv[i], "--widths"))                      st.cfg.widths = true;
+        else {
+            fprintf(stderr, "usage: %s [--cases n] [--threads n] [--seed n] [--max-cores n] [--max-ops n] [--out f] [--coverage] [--protocol mesi|moesi|mesif|dragon|firefly] [--update-limit k] [--migratory] [--atomics pct] [--far-atomics] [--widths]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (st.cfg.max_cores < st.cfg.min_cores) st.cfg.max_cores = st.cfg.min_cores;
+
+    QUIET = true;
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++) pool.emplace_back(worker, std::ref(st));
+    for (auto& th : pool) th.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    fprintf(stdout, "%llu cases on %d threads in %.2f s: %.0f cases/s, %.0f ops/s\n",
+        (unsigned long long)st.cases_run.load(), threads, secs,
+        (double)st.cases_run.load() / secs, (double)st.ops_run.load() / secs);
+    fprintf(stdout, "corpus %zu traces, coverage %d / %d points, %d edges\n",
+        st.corpus.size(), st.global.covered(), TransitionCoverage::NUM_POINTS,
+        st.global.edges_covered());
+    if (show_coverage) st.global.print_report(stdout);
+
+    if (!st.failed) return 0;
+
+    fprintf(stdout, "\ncase %llu FAILED (%zu ops, %d cores): %s\n",
+        (unsigned long long)st.fail_case, st.fail_trace.ops.size(), st.fail_trace.num_cores,
+        st.fail_result.message.c_str());
+
+    FuzzResult::Kind kind = st.fail_result.kind;
+    FuzzTrace min = fuzz_minimize(st.fail_trace, [kind](const FuzzTrace& t) {
+        return fuzz_run(t).kind == kind;
+    });
+    FuzzResult min_result = fuzz_run(min);
+
+    fprintf(stdout, "minimized to %zu ops on %d cores:\n\n", min.ops.size(), min.num_cores);
+    fuzz_print_reproducer(stdout, min, min_result);
+    if (FILE* f = fopen(out_path, "w")) {
+        fuzz_print_reproducer(f, min, min_result);
+        fclose(f);
+        fprintf(stdout, "\nreproducer written to %s\n", out_path);
+    }
+    return 1;
+}
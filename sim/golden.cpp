@@ -0,0 +1,98 @@
+// golden.cpp
+#include "golden.hpp"
+#include "config.hpp"
+#include "log.hpp"
+
+const GoldenMemory::LineHistory* GoldenMemory::find_line(uint32_t addr) const {
+    auto it = lines.find(addr / LINE_SIZE);
+    return it == lines.end() ? nullptr : &it->second;
+}
+
+const GoldenMemory::ByteHistory* GoldenMemory::find(uint32_t addr) const {
+    const LineHistory* l = find_line(addr);
+    return l ? &l->bytes[addr % LINE_SIZE] : nullptr;
+}
+
+uint64_t GoldenMemory::version(uint32_t addr) const {
+    const ByteHistory* b = find(addr);
+    return b ? b->version : 0;
+}
+
+uint8_t GoldenMemory::value(uint32_t addr) const {
+    const ByteHistory* b = find(addr);
+    return b ? b->values[b->version % HISTORY] : 0;
+}
+
+void GoldenMemory::store(int cache_id, uint32_t addr, uint8_t value, uint64_t cycle){
+    store(cache_id, addr, &value, 1, cycle);
+}
+
+void GoldenMemory::versions(uint32_t addr, int size, uint64_t* out) const {
+    const LineHistory* l = find_line(addr);
+    for (int i = 0; i < size; i++) out[i] = l ? l->bytes[addr % LINE_SIZE + i].version : 0;
+}
+
+void GoldenMemory::store(int cache_id, uint32_t addr, const uint8_t* bytes, int size, uint64_t cycle){
+    ByteHistory* line = lines[addr / LINE_SIZE].bytes + addr % LINE_SIZE;
+    for (int i = 0; i < size; i++) {
+        ByteHistory& b = line[i];
+        b.version++;
+        b.values[b.version % HISTORY] = bytes[i];
+        b.last_writer = cache_id;
+        b.last_write_cycle = cycle;
+    }
+}
+
+bool GoldenMemory::check_load(int core_id, uint32_t addr, const uint8_t* bytes, int size,
+                              const uint64_t* since, uint64_t issue_cycle, uint64_t cycle){
+    static const LineHistory initial;
+    const LineHistory* line = find_line(addr);
+    const ByteHistory* hist = (line ? line : &initial)->bytes + addr % LINE_SIZE;
+    for (int i = 0; since && i < size; i++) {
+        if (hist[i].version - since[i] >= HISTORY) {
+            num_unchecked++;
+            return true;
+        }
+    }
+    num_checked++;
+
+    for (int i = 0; i < size; i++) {
+        const ByteHistory* b = &hist[i];
+        // any value from the accept-time version up to the latest one is legal
+        bool ok = false;
+        for (uint64_t v = since ? since[i] : b->version; v <= b->version && !ok; v++) {
+            ok = b->values[v % HISTORY] == bytes[i];
+        }
+        if (ok) continue;
+
+        num_stale++;
+        if (num_stale == 1) {
+            first.core_id = core_id;
+            first.addr = addr + i;
+            first.got = bytes[i];
+            first.expected = b->values[b->version % HISTORY];
+            first.issue_cycle = issue_cycle;
+            first.cycle = cycle;
+            first.last_writer = b->last_writer;
+            first.last_write_cycle = b->last_write_cycle;
+        }
+        return false;
+    }
+    return true;
+}
+
+std::string GoldenMemory::describe(const StaleRead& s){
+    char msg[256];
+    int n = snprintf(msg, sizeof(msg),
+        "VALUE VIOLATION: core %d load addr 0x%x (issued cycle %llu, completed cycle %llu) "
+        "returned %u, expected %u",
+        s.core_id, s.addr, (unsigned long long)s.issue_cycle, (unsigned long long)s.cycle,
+        s.got, s.expected);
+    if (s.last_writer >= 0) {
+        snprintf(msg + n, sizeof(msg) - n, " written by cache %d at cycle %llu",
+            s.last_writer, (unsigned long long)s.last_write_cycle);
+    } else {
+        snprintf(msg + n, sizeof(msg) - n, " (initial memory)");
+    }
+    return msg;
+}
@@ -0,0 +1,76 @@
+#ifndef GOLDEN_HPP
+#define GOLDEN_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "config.hpp"
+
+// Sequentially consistent reference memory. Stores are applied at the
+// point they become visible in the cache hierarchy; a load is legal if it
+// returns a value the byte held at some point between the load's accept
+// and its completion. Each byte keeps its last HISTORY values, so a check
+// is O(writes overlapping the load), bounded by HISTORY. Wider loads are
+// checked byte by byte against each byte's own window.
+class GoldenMemory {
+public:
+    static constexpr uint32_t HISTORY = 8;
+
+    struct StaleRead {
+        int core_id = -1;
+        uint32_t addr = 0;
+        uint32_t got = 0;
+        uint32_t expected = 0;       // latest value at completion
+        uint64_t issue_cycle = 0;
+        uint64_t cycle = 0;
+        int last_writer = -1;        // cache that wrote `expected`, -1 = initial
+        uint64_t last_write_cycle = 0;
+    };
+
+    uint64_t version(uint32_t addr) const;
+    uint8_t value(uint32_t addr) const;
+    void store(int cache_id, uint32_t addr, uint8_t value, uint64_t cycle);
+    // the multi-byte forms stay within one line
+    void versions(uint32_t addr, int size, uint64_t* out) const;
+    void store(int cache_id, uint32_t addr, const uint8_t* bytes, int size, uint64_t cycle);
+    // false on a stale read; the first one is kept in first_stale().
+    // since[i] is byte i's version at accept, nullptr means only the
+    // latest value is legal
+    bool check_load(int core_id, uint32_t addr, const uint8_t* bytes, int size,
+                    const uint64_t* since, uint64_t issue_cycle, uint64_t cycle);
+    bool check_load(int core_id, uint32_t addr, uint8_t value,
+                    uint64_t since_version, uint64_t issue_cycle, uint64_t cycle){
+        return check_load(core_id, addr, &value, 1, &since_version, issue_cycle, cycle);
+    }
+
+    uint64_t loads_checked() const { return num_checked; }
+    // loads whose window overlapped more than HISTORY writes
+    uint64_t loads_unchecked() const { return num_unchecked; }
+    uint64_t stale_reads() const { return num_stale; }
+    const StaleRead& first_stale() const { return first; }
+
+    static std::string describe(const StaleRead& s);
+
+private:
+    struct ByteHistory {
+        uint32_t version = 0;        // version 0 is the zeroed initial memory
+        int32_t last_writer = -1;
+        uint64_t last_write_cycle = 0;
+        uint8_t values[HISTORY] = {};  // values[v % HISTORY] holds version v
+    };
+    struct LineHistory {
+        ByteHistory bytes[LINE_SIZE];
+    };
+
+    // only lines that were ever stored to
+    std::unordered_map<uint32_t, LineHistory> lines;
+    uint64_t num_checked = 0;
+    uint64_t num_unchecked = 0;
+    uint64_t num_stale = 0;
+    StaleRead first;
+
+    const ByteHistory* find(uint32_t addr) const;
+    const LineHistory* find_line(uint32_t addr) const;
+};
+
+#endif
@@ -0,0 +1,73 @@
+// importer.cpp
+// Converts real application traces to the simulator's binary trace format
+// and optionally replays them. Input is Valgrind Lackey output or a
+// DynamoRIO drmemtrace text dump; "-" reads stdin.
+//
+//   g++ -O2 -pthread importer.cpp -o importer
+//   valgrind --tool=lackey --trace-mem=yes --log-file=app.lackey ./app
+//   ./importer --lackey app.lackey -o app.mtr
+//   drrun -t drcachesim -simulator_type view -- ./app 2> app.view
+//   ./importer --drmemtrace app.view -o app.mtr --cores 8 --threads 8 --run
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "system.cpp"
+#include "log.cpp"
+
+int main(int argc, char** argv) {
+    ImportConfig cfg;
+    cfg.threads = (int)std::thread::hardware_concurrency();
+    const char* in_path = nullptr;
+    const char* out_path = nullptr;
+    bool run = false;
+    uint32_t max_cycles = 100000000;
+
+    for (int i = 1; i < argc; i++) {
+        if      (!strcmp(argv[i], "--lackey") && i + 1 < argc)     { cfg.format = TraceFormat::LACKEY; in_path = argv[++i]; }
+        else if (!strcmp(argv[i], "--drmemtrace") && i + 1 < argc) { cfg.format = TraceFormat::DRMEMTRACE; in_path = argv[++i]; }
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)           out_path = argv[++i];
+        else if (!strcmp(argv[i], "--cores") && i + 1 < argc)      cfg.num_cores = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)    cfg.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--mem") && i + 1 < argc)        cfg.mem_bytes = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--run"))                        run = true;
+        else if (!strcmp(argv[i], "--max-cycles") && i + 1 < argc) max_cycles = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else {
+            in_path = nullptr;
+            break;
+        }
+    }
+    // pages are packed into --mem, so it must hold whole pages
+    if (!in_path || !out_path || cfg.num_cores < 1 || cfg.num_cores > 256
+        || cfg.mem_bytes < TraceImporter::PAGE_SIZE || cfg.mem_bytes % TraceImporter::PAGE_SIZE) {
+        fprintf(stderr, "usage: %s --lackey f|--drmemtrace f -o out.mtr [--cores n] [--threads n] [--mem bytes, a multiple of 4096] [--run] [--max-cycles n]\n", argv[0]);
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    TraceImporter imp(cfg);
+    if (!imp.convert(in_path, out_path)) {
+        fprintf(stderr, "failed to convert %s to %s\n", in_path, out_path);
+        return 1;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    const ImportStats& st = imp.stats();
+    fprintf(stdout, "%llu lines, %llu accesses (%llu split), %llu ops on %d cores from %llu threads in %.2f s\n",
+        (unsigned long long)st.lines, (unsigned long long)st.accesses, (unsigned long long)st.split,
+        (unsigned long long)st.ops, cfg.num_cores, (unsigned long long)st.threads_seen, secs);
+    fprintf(stdout, "%llu pages%s\n", (unsigned long long)st.pages,
+        st.aliased_pages ? ", some folded: raise --mem to keep them apart" : "");
+    if (!run) return 0;
+
+    BinaryTraceWorkload w;
+    if (!w.open(out_path)) {
+        fprintf(stderr, "cannot read back %s\n", out_path);
+        return 1;
+    }
+    System sys(w.num_cores(), cfg.mem_bytes);
+    sys.attach_workload(&w);
+    sys.run(max_cycles);
+    return sys.has_violation() || w.malformed() ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+// latency.cpp
+#include "latency.hpp"
+#include "core.hpp"
+#include "log.hpp"
+#include <cassert>
+
+// ---- LatencyHistogram ----
+
+int LatencyHistogram::bucket_of(uint64_t v){
+    if (v < (uint64_t)SUB_COUNT) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - SUB_BITS;
+    int sub = (int)(v >> shift) - SUB_COUNT;
+    return ((shift + 1) << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::bucket_high(int idx){
+    if (idx < SUB_COUNT) return (uint64_t)idx;
+    int shift = (idx >> SUB_BITS) - 1;
+    uint64_t sub = (uint64_t)(idx & (SUB_COUNT - 1)) + SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t v){
+    int b = bucket_of(v);
+    if ((int)buckets.size() <= b) buckets.resize(b + 1, 0);
+    buckets[b]++;
+    n++;
+    sum += v;
+    if (v < lo) lo = v;
+    if (v > hi) hi = v;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other){
+    if (other.n == 0) return;
+    if (buckets.size() < other.buckets.size()) buckets.resize(other.buckets.size(), 0);
+    for (size_t i = 0; i < other.buckets.size(); i++) {
+        buckets[i] += other.buckets[i];
+    }
+    n   += other.n;
+    sum += other.sum;
+    if (other.lo < lo) lo = other.lo;
+    if (other.hi > hi) hi = other.hi;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (n == 0) return 0;
+    uint64_t rank = (uint64_t)(p * (double)n);
+    if (rank >= n) rank = n - 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            uint64_t v = bucket_high((int)i);
+            return v < hi ? v : hi;
+        }
+    }
+    return hi;
+}
+
+// ---- LatencyStats ----
+
+const char* latency_req_name(LatencyReq req){
+    switch (req) {
+        case LatencyReq::None:    return "none";
+        case LatencyReq::BusRd:   return "BusRd";
+        case LatencyReq::BusRdX:  return "BusRdX";
+        case LatencyReq::BusUpgr: return "BusUpgr";
+        case LatencyReq::BusUpd:  return "BusUpd";
+        case LatencyReq::BusAtomic: return "BusAtomic";
+    }
+    return "?";
+}
+
+LatencyStats::LatencyStats(int num_cores_)
+    : num_cores(num_cores_),
+      hists((size_t)num_cores_ * NUM_OPS * 2 * NUM_REQS)
+{}
+
+int LatencyStats::slot(OpType op, bool hit, LatencyReq req){
+    return (op_class(op) * 2 + (hit ? 1 : 0)) * NUM_REQS + (int)req;
+}
+
+void LatencyStats::record(int core_id, OpType op, bool hit, LatencyReq req, uint64_t cycles){
+    assert(core_id >= 0 && core_id < num_cores);
+    hists[(size_t)core_id * NUM_OPS * 2 * NUM_REQS + slot(op, hit, req)].record(cycles);
+}
+
+const LatencyHistogram& LatencyStats::get(int core_id, OpType op, bool hit, LatencyReq req) const {
+    assert(core_id >= 0 && core_id < num_cores);
+    return hists[(size_t)core_id * NUM_OPS * 2 * NUM_REQS + slot(op, hit, req)];
+}
+
+LatencyHistogram LatencyStats::total(int core_id, OpType op) const {
+    LatencyHistogram h;
+    int first = core_id < 0 ? 0 : core_id;
+    int last  = core_id < 0 ? num_cores - 1 : core_id;
+    for (int c = first; c <= last; c++) {
+        for (int hit = 0; hit < 2; hit++) {
+            for (int r = 0; r < NUM_REQS; r++) {
+                h.merge(get(c, op, hit, (LatencyReq)r));
+            }
+        }
+    }
+    return h;
+}
+
+void LatencyStats::print_summary() const {
+    const OpType ops[NUM_OPS] = {OpType::LOAD, OpType::STORE, OpType::CAS};
+    const char* names[NUM_OPS] = {"LOAD", "STORE", "ATOMIC"};
+    for (int o = 0; o < NUM_OPS; o++) {
+        LatencyHistogram h = total(-1, ops[o]);
+        if (h.count() == 0) continue;
+        printf("%s latency: mean %.2f, p50 %llu, p99 %llu, p999 %llu, max %llu\n",
+            names[o], h.mean(),
+            (unsigned long long)h.percentile(0.50),
+            (unsigned long long)h.percentile(0.99),
+            (unsigned long long)h.percentile(0.999),
+            (unsigned long long)h.max());
+    }
+}
+
+void LatencyStats::print_report() const {
+    const OpType ops[NUM_OPS] = {OpType::LOAD, OpType::STORE, OpType::CAS};
+    const char* names[NUM_OPS] = {"LOAD", "STORE", "ATOMIC"};
+
+    printf("\n --- LATENCY (cycles, accept -> complete) --- \n");
+    printf("%4s %-6s %-4s %-9s %8s %8s %6s %6s %6s %6s\n",
+        "core", "op", "hit", "req", "count", "mean", "p50", "p99", "p999", "max");
+    for (int c = 0; c < num_cores; c++) {
+        for (int o = 0; o < NUM_OPS; o++) {
+            for (int hit = 1; hit >= 0; hit--) {
+                for (int r = 0; r < NUM_REQS; r++) {
+                    const LatencyHistogram& h = get(c, ops[o], hit, (LatencyReq)r);
+                    if (h.count() == 0) continue;
+                    printf("%4d %-6s %-4s %-9s %8llu %8.2f %6llu %6llu %6llu %6llu\n",
+                        c, names[o], hit ? "hit" : "miss", latency_req_name((LatencyReq)r),
+                        (unsigned long long)h.count(), h.mean(),
+                        (unsigned long long)h.percentile(0.50),
+                        (unsigned long long)h.percentile(0.99),
+                        (unsigned long long)h.percentile(0.999),
+                        (unsigned long long)h.max());
+                }
+            }
+        }
+    }
+}
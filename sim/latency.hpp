@@ -0,0 +1,79 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include <cstdint>
+#include <vector>
+
+enum class OpType;
+
+// Log-bucketed histogram. Values below 16 get exact buckets, every power of
+// two above that is split into 16 linear sub-buckets (<= 6.25% error).
+class LatencyHistogram {
+public:
+    void record(uint64_t v);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return n; }
+    uint64_t min() const { return n ? lo : 0; }
+    uint64_t max() const { return hi; }
+    double mean() const { return n ? (double)sum / (double)n : 0.0; }
+
+    // upper edge of the bucket holding the p-quantile (p in [0,1])
+    uint64_t percentile(double p) const;
+
+private:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+
+    std::vector<uint64_t> buckets; // allocated on first record
+    uint64_t n   = 0;
+    uint64_t sum = 0;
+    uint64_t lo  = UINT64_MAX;
+    uint64_t hi  = 0;
+
+    static int bucket_of(uint64_t v);
+    static uint64_t bucket_high(int idx);
+};
+
+// how an op was serviced: no bus transaction, or the one it issued
+enum class LatencyReq {
+    None,
+    BusRd,
+    BusRdX,
+    BusUpgr,
+    BusUpd,
+    BusAtomic
+};
+
+// Per-core latency histograms from accept_request to notify_complete,
+// split by op class (load, store, atomic), hit/miss and the bus request
+// that serviced the op. A line-crossing op is one sample, from its first
+// line's accept to its last line's completion, so samples match memory
+// instructions.
+class LatencyStats {
+public:
+    static constexpr int NUM_OPS  = 3;
+    static constexpr int NUM_REQS = 6;
+
+    explicit LatencyStats(int num_cores = 0);
+
+    void record(int core_id, OpType op, bool hit, LatencyReq req, uint64_t cycles);
+
+    const LatencyHistogram& get(int core_id, OpType op, bool hit, LatencyReq req) const;
+    // merged over hit/miss and request type; core_id = -1 merges all cores
+    // op selects its class: any atomic merges all atomics
+    LatencyHistogram total(int core_id, OpType op) const;
+
+    void print_summary() const;
+    void print_report() const;
+
+private:
+    int num_cores;
+    std::vector<LatencyHistogram> hists; // [core][op class][hit][req]
+
+    static int slot(OpType op, bool hit, LatencyReq req);
+};
+
+const char* latency_req_name(LatencyReq req);
+
+#endif
@@ -2,11 +2,10 @@
 #include "system.cpp"
 #include "system.hpp"
 #include "tests.cpp"
+#include "test_runner.cpp"
 
 
-int main(){
+int main(int argc, char** argv){
 
-    run_all_architectural_tests();
-
-    return 0;
-}
\ No newline at end of file
+    return run_test_suite(ALL_TESTS, NUM_TESTS, argc, argv);
+}
@@ -0,0 +1,74 @@
+// mcheck.cpp
+// Exhaustive model checking of the coherence protocol on tiny systems:
+// every interleaving of loads and stores over 1-2 addresses and a few
+// values, explored breadth first so a violation comes with the shortest
+// counterexample.
+//
+//   g++ -O2 mcheck.cpp -o mcheck
+//   ./mcheck                              2-4 caches x 1-2 addresses
+//   ./mcheck --caches 3 --addrs 2 --values 2
+//   ./mcheck --caches 4 --addrs 2 --split-sets --no-symmetry
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "system.cpp"
+#include "log.cpp"
+
+static bool check_one(const ModelCheckConfig& cfg) {
+    auto t0 = std::chrono::steady_clock::now();
+    ModelChecker mc(cfg);
+    ModelChecker::Result r = mc.run();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    char label[80];
+    char proto[32];
+    snprintf(proto, sizeof(proto), cfg.update_limit ? "%s/k=%u" : "%s", protocol_name(cfg.protocol), cfg.update_limit);
+    if (cfg.migratory) strcat(proto, "+mig");
+    if (cfg.atomics) strcat(proto, cfg.far_atomics ? "+far" : "+atom");
+    snprintf(label, sizeof(label), "%s, %d caches, %d addr%s, %d values", proto,
+        cfg.num_caches, cfg.num_addrs,
+        cfg.num_addrs == 1 ? "" : (cfg.same_set ? "s (one set)" : "s (two sets)"), cfg.num_values);
+    fprintf(stdout, "%-44s %10llu states %11llu transitions  depth %3d  %7.2f s  %s\n",
+        label, (unsigned long long)r.states, (unsigned long long)r.transitions, r.depth, secs,
+        r.violated ? "VIOLATION" : (r.complete ? "ok" : "state limit hit"));
+    if (r.violated) mc.print_trace(stdout, r);
+    return !r.violated;
+}
+
+int main(int argc, char** argv) {
+    ModelCheckConfig cfg;
+    int caches = 0, addrs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if      (!strcmp(argv[i], "--caches") && i + 1 < argc)     caches = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--addrs") && i + 1 < argc)      addrs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--values") && i + 1 < argc)     cfg.num_values = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-states") && i + 1 < argc) cfg.max_states = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--split-sets"))                 cfg.same_set = false;
+        else if (!strcmp(argv[i], "--no-symmetry"))                cfg.symmetry = false;
+        else if (!strcmp(argv[i], "--protocol") && i + 1 < argc && parse_protocol(argv[i + 1], cfg.protocol)) i++;
+        else if (!strcmp(argv[i], "--update-limit") && i + 1 < argc) cfg.update_limit = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--migratory"))                  cfg.migratory = true;
+        else if (!strcmp(argv[i], "--atomics"))                    cfg.atomics = true;
+        else if (!strcmp(argv[i], "--far-atomics"))                cfg.atomics = cfg.far_atomics = true;
+        else if (!strcmp(argv[i], "--bus-width") && i + 1 < argc)  cfg.bus.width_bytes = (uint32_t)atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--caches n] [--addrs 1|2] [--values n] [--max-states n] [--split-sets] [--no-symmetry] [--protocol mesi|moesi|mesif|dragon|firefly] [--update-limit k] [--migratory] [--atomics] [--far-atomics] [--bus-width bytes]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    QUIET = true;
+
+    bool ok = true;
+    for (int n = caches ? caches : 2; n <= (caches ? caches : 4); n++) {
+        for (int a = addrs ? addrs : 1; a <= (addrs ? addrs : 2); a++) {
+            cfg.num_caches = n;
+            cfg.num_addrs = a;
+            ok &= check_one(cfg);
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// migratory.cpp
+#include "migratory.hpp"
+#include "config.hpp"
+
+MigratoryPredictor::MigratoryPredictor(uint32_t entries)
+    : table(entries ? entries : 1)
+{}
+
+void MigratoryPredictor::set_entries(uint32_t n){
+    table.assign(n ? n : 1, Entry{});
+}
+
+MigratoryPredictor::Entry* MigratoryPredictor::find(uint32_t addr){
+    uint32_t line = addr / LINE_SIZE;
+    Entry& e = table[line % table.size()];
+    return e.line == line ? &e : nullptr;
+}
+
+const MigratoryPredictor::Entry* MigratoryPredictor::find(uint32_t addr) const {
+    uint32_t line = addr / LINE_SIZE;
+    const Entry& e = table[line % table.size()];
+    return e.line == line ? &e : nullptr;
+}
+
+MigratoryPredictor::Entry& MigratoryPredictor::claim(uint32_t addr){
+    uint32_t line = addr / LINE_SIZE;
+    Entry& e = table[line % table.size()];
+    if (e.line != line) {
+        if (e.line != UINT32_MAX) replaced++;
+        e = Entry{};
+        e.line = line;
+    }
+    return e;
+}
+
+bool MigratoryPredictor::predict(uint32_t addr) const {
+    const Entry* e = find(addr);
+    return e && e->confidence >= threshold;
+}
+
+int MigratoryPredictor::dirty_reader(uint32_t addr) const {
+    const Entry* e = find(addr);
+    return e ? e->dirty_reader : -1;
+}
+
+int MigratoryPredictor::confidence(uint32_t addr) const {
+    const Entry* e = find(addr);
+    return e ? e->confidence : 0;
+}
+
+void MigratoryPredictor::on_read(uint32_t addr, int reader, bool from_dirty){
+    // only lines that were written somewhere are worth an entry
+    Entry* e = from_dirty ? &claim(addr) : find(addr);
+    if (e) e->dirty_reader = from_dirty ? (int16_t)reader : -1;
+}
+
+void MigratoryPredictor::on_upgrade(uint32_t addr, int writer, int other_copies){
+    Entry* e = find(addr);
+    if (!e) return;
+    if (e->dirty_reader == writer && other_copies == 1) {
+        if (e->confidence < 3) e->confidence++;
+        detected++;
+    } else if (other_copies > 1) {
+        // read-shared by several caches: not migrating
+        e->confidence = 0;
+    }
+    e->dirty_reader = -1;
+}
+
+void MigratoryPredictor::on_mispredict(uint32_t addr){
+    Entry* e = find(addr);
+    if (e) e->confidence = 0;
+}
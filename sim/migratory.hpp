@@ -0,0 +1,51 @@
+#ifndef MIGRATORY_HPP
+#define MIGRATORY_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Detects migratory lines: read then written by one cache at a time.
+// A BusUpgr from a cache whose copy came from a dirty owner, with that
+// owner's copy the only other one, is one migration; after `threshold` of
+// them a line is predicted migratory and its next BusRd is answered with
+// ownership. A grant that is read elsewhere (or evicted) before its store
+// is a misprediction and resets the line.
+class MigratoryPredictor {
+public:
+    explicit MigratoryPredictor(uint32_t entries = 256);
+
+    // direct-mapped, one entry per line address modulo the table size
+    void set_entries(uint32_t n);
+    void set_threshold(uint32_t t) { threshold = t < 1 ? 1 : (t > 3 ? 3 : t); }
+
+    bool predict(uint32_t addr) const;
+    // entry state of a line, -1 / 0 when it has none
+    int dirty_reader(uint32_t addr) const;
+    int confidence(uint32_t addr) const;
+
+    // bus observations
+    void on_read(uint32_t addr, int reader, bool from_dirty);
+    void on_upgrade(uint32_t addr, int writer, int other_copies);
+    void on_mispredict(uint32_t addr);
+
+    uint64_t detections() const { return detected; }
+    uint64_t replacements() const { return replaced; }
+
+private:
+    struct Entry {
+        uint32_t line = UINT32_MAX;
+        int16_t dirty_reader = -1; // last cache whose BusRd was served by a dirty owner
+        uint8_t confidence = 0;    // saturating 0..3
+    };
+
+    std::vector<Entry> table;
+    uint32_t threshold = 1;
+    uint64_t detected = 0;
+    uint64_t replaced = 0;
+
+    Entry* find(uint32_t addr);
+    const Entry* find(uint32_t addr) const;
+    Entry& claim(uint32_t addr);
+};
+
+#endif
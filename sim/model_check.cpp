@@ -0,0 +1,263 @@
+// model_check.cpp
+#include "model_check.hpp"
+#include "system.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cassert>
+#include <deque>
+
+// memory covers both address layouts; small so replays are cheap
+static constexpr uint32_t MC_MEM_BYTES = 4096;
+
+ModelChecker::ModelChecker(const ModelCheckConfig& cfg_)
+    : cfg(cfg_)
+{
+    assert(cfg.num_caches >= 1 && cfg.num_addrs >= 1 && cfg.num_addrs <= 2);
+    assert(cfg.num_values >= 1 && cfg.num_values <= 7);
+}
+
+uint32_t ModelChecker::addr_of(int i) const {
+    // same_set: tags 0/1 of set 0; otherwise sets 0/1 of tag 0
+    return cfg.same_set ? (uint32_t)i * LINE_SIZE * 32 : (uint32_t)i * LINE_SIZE;
+}
+
+ModelChecker::Replay ModelChecker::replay(int64_t node) const {
+    Replay r;
+    r.sys.reset(new System(cfg.num_caches, MC_MEM_BYTES));
+    r.sys->set_print_report(false);
+    r.sys->set_violations_fatal(false);
+    r.sys->set_protocol(cfg.protocol);
+    r.sys->set_update_limit(cfg.update_limit);
+    r.sys->set_migratory_sharing(cfg.migratory);
+    r.sys->set_far_atomics(cfg.far_atomics);
+    r.sys->configure_bus(cfg.bus);
+    r.load_legal.assign(cfg.num_caches, 0);
+    for (const Choice& c : path_to(node)) apply(r, c);
+    return r;
+}
+
+void ModelChecker::apply(Replay& r, const Choice& c) const {
+    System& s = *r.sys;
+    uint64_t before[2];
+    for (int i = 0; i < cfg.num_addrs; i++) before[i] = s.golden.version(addr_of(i));
+
+    if (c.core >= 0) {
+        uint32_t addr = addr_of(c.addr);
+        s.cores[c.core]->add_op(c.type, addr, c.value, c.expected, 1);
+        if (c.type == OpType::LOAD) r.load_legal[c.core] = (uint8_t)(1u << s.golden.value(addr));
+    }
+    s.run(1);
+
+    // a store performed this cycle widens the legal set of loads in flight
+    for (int i = 0; i < cfg.num_addrs; i++) {
+        uint32_t addr = addr_of(i);
+        if (s.golden.version(addr) == before[i]) continue;
+        uint8_t bit = (uint8_t)(1u << s.golden.value(addr));
+        for (int k = 0; k < cfg.num_caches; k++) {
+            Cache* cache = s.caches[k];
+            if (cache->busy && cache->current_op.type == OpType::LOAD && cache->current_op.addr == addr) {
+                r.load_legal[k] |= bit;
+            }
+        }
+    }
+}
+
+std::string ModelChecker::cache_key(const Replay& r, int id) const {
+    const System& s = *r.sys;
+    const Cache* c = s.caches[id];
+    std::string k;
+
+    uint32_t sets_done = 0;
+    for (int i = 0; i < cfg.num_addrs; i++) {
+        uint32_t idx = c->index(addr_of(i));
+        if (sets_done & (1u << idx)) continue;
+        sets_done |= 1u << idx;
+
+        const Cache::CacheLine& line = c->lines[idx];
+        int which = -1;
+        for (int j = 0; j < cfg.num_addrs; j++) {
+            if (c->index(addr_of(j)) == idx && c->tag(addr_of(j)) == line.tag) which = j;
+        }
+        // tag and data of an invalid line only matter to a load in flight on it
+        bool live = line.state != Cache::LineState::I
+                 || (c->busy && c->current_op.type == OpType::LOAD && c->index(c->current_op.addr) == idx);
+        k += (char)line.state;
+        k += live ? (char)(which + 1) : 0;
+        k += live ? (char)line.data[0] : 0;
+        k += live ? (char)line.unused_updates : 0;
+        k += live ? (char)line.migrated : 0;
+    }
+    // predictor entries name caches, so only "is it me" survives symmetry
+    if (cfg.migratory) {
+        for (int i = 0; i < cfg.num_addrs; i++) k += (char)(s.migratory.dirty_reader(addr_of(i)) == id);
+    }
+
+    k += (char)c->busy;
+    if (c->busy) {
+        int addr_idx = 0;
+        for (int j = 0; j < cfg.num_addrs; j++) if (addr_of(j) == c->current_op.addr) addr_idx = j;
+        k += (char)(c->ready_at - s.now());
+        k += (char)c->waiting_for_bus;
+        k += (char)c->current_op.type;
+        k += (char)addr_idx;
+        k += (char)c->current_op.data;
+        k += c->current_op.type == OpType::LOAD ? (char)r.load_legal[id] : 0;
+        // an atomic's old value, once it performed, is returned at completion
+        k += is_atomic(c->current_op.type) ? (char)c->atomic_old : 0;
+        k += (char)c->current_op.expected;
+    }
+    return k;
+}
+
+std::string ModelChecker::encode(const Replay& r) const {
+    std::vector<std::string> parts;
+    for (int k = 0; k < cfg.num_caches; k++) parts.push_back(cache_key(r, k));
+    if (cfg.symmetry) std::sort(parts.begin(), parts.end());
+
+    std::string key;
+    for (const auto& p : parts) {
+        key += (char)p.size();
+        key += p;
+    }
+    for (int i = 0; i < cfg.num_addrs; i++) {
+        uint8_t line[LINE_SIZE];
+        r.sys->memory->read_line(addr_of(i), line);
+        key += (char)line[0];
+        key += (char)r.sys->golden.value(addr_of(i));
+        if (cfg.migratory) key += (char)r.sys->migratory.confidence(addr_of(i));
+    }
+    // data bus reservations can delay later fills. Soft ones never delay
+    // anything, and no transfer granted from now on starts before the
+    // horizon, so only hard slots ending past it are part of the state
+    uint64_t now = r.sys->now();
+    const BusConfig& bc = r.sys->bus->config();
+    uint64_t horizon = now + std::min(bc.c2c_latency, bc.mem_latency);
+    for (const Bus::Slot& slot : r.sys->bus->slots) {
+        if (slot.soft || slot.end <= horizon) continue;
+        key += (char)(slot.start > now ? slot.start - now : 0);
+        key += (char)(slot.end - now);
+    }
+    return key;
+}
+
+std::vector<ModelChecker::Choice> ModelChecker::path_to(int64_t node) const {
+    std::vector<Choice> path;
+    for (int64_t n = node; n > 0; n = nodes[n].parent) path.push_back(nodes[n].choice);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+ModelChecker::Result ModelChecker::run() {
+    Result res;
+    nodes.clear();
+    seen.clear();
+
+    nodes.push_back({-1, {-1, OpType::LOAD, 0, 0, 0}, 0});
+    seen.insert(encode(replay(0)));
+
+    std::vector<Choice> ops;
+    for (int a = 0; a < cfg.num_addrs; a++) {
+        ops.push_back({0, OpType::LOAD, a, 0, 0});
+        for (int v = 1; v <= cfg.num_values; v++) ops.push_back({0, OpType::STORE, a, (uint8_t)v, 0});
+        if (!cfg.atomics) continue;
+        // values stay within 0..num_values
+        ops.push_back({0, OpType::TAS, a, 0, 0});
+        for (int v = 1; v <= cfg.num_values; v++) {
+            ops.push_back({0, OpType::SWAP, a, (uint8_t)v, 0});
+            ops.push_back({0, OpType::CAS, a, (uint8_t)v, (uint8_t)(v - 1)});
+        }
+    }
+
+    for (size_t head = 0; head < nodes.size(); head++) {
+        if (seen.size() >= cfg.max_states) {
+            res.states = seen.size();
+            return res; // incomplete
+        }
+        int64_t node = (int64_t)head;
+        res.depth = std::max(res.depth, nodes[node].depth);
+
+        // every idle core may issue any op; with symmetry, only one of a
+        // group of idle caches in identical states needs to
+        std::vector<Choice> choices;
+        choices.push_back({-1, OpType::LOAD, 0, 0, 0});
+        {
+            Replay parent = replay(node);
+            std::vector<std::string> tried;
+            for (int k = 0; k < cfg.num_caches; k++) {
+                if (parent.sys->caches[k]->busy) continue;
+                if (cfg.symmetry) {
+                    std::string key = cache_key(parent, k);
+                    if (std::find(tried.begin(), tried.end(), key) != tried.end()) continue;
+                    tried.push_back(key);
+                }
+                for (Choice c : ops) {
+                    c.core = k;
+                    choices.push_back(c);
+                }
+            }
+        }
+
+        for (const Choice& c : choices) {
+            Replay r = replay(node);
+            apply(r, c);
+            res.transitions++;
+
+            if (!seen.insert(encode(r)).second && !r.sys->has_violation()) continue;
+            nodes.push_back({node, c, nodes[node].depth + 1});
+
+            if (r.sys->has_violation()) {
+                res.states = seen.size();
+                res.violated = true;
+                res.message = r.sys->violation_message();
+                res.trace = path_to((int64_t)nodes.size() - 1);
+                return res;
+            }
+        }
+    }
+
+    res.states = seen.size();
+    res.complete = true;
+    return res;
+}
+
+void ModelChecker::print_trace(FILE* out, const Result& r) const {
+    Replay rp;
+    rp.sys.reset(new System(cfg.num_caches, MC_MEM_BYTES));
+    rp.sys->set_print_report(false);
+    rp.sys->set_violations_fatal(false);
+    rp.sys->set_protocol(cfg.protocol);
+    rp.sys->set_update_limit(cfg.update_limit);
+    rp.sys->set_migratory_sharing(cfg.migratory);
+    rp.sys->set_far_atomics(cfg.far_atomics);
+    rp.sys->configure_bus(cfg.bus);
+    rp.load_legal.assign(cfg.num_caches, 0);
+
+    fprintf(out, "counterexample, %zu cycles (%d caches, addresses:", r.trace.size(), cfg.num_caches);
+    for (int i = 0; i < cfg.num_addrs; i++) fprintf(out, " %c=0x%x", 'A' + i, addr_of(i));
+    fprintf(out, ")\n");
+
+    for (size_t t = 0; t < r.trace.size(); t++) {
+        const Choice& c = r.trace[t];
+        apply(rp, c);
+        char op[32] = "-";
+        if (c.core >= 0 && c.type == OpType::LOAD) {
+            snprintf(op, sizeof(op), "core %d LD %c", c.core, 'A' + c.addr);
+        } else if (c.core >= 0 && c.type == OpType::STORE) {
+            snprintf(op, sizeof(op), "core %d ST %c=%u", c.core, 'A' + c.addr, c.value);
+        } else if (c.core >= 0 && c.type == OpType::CAS) {
+            snprintf(op, sizeof(op), "core %d CAS %c:%u>%u", c.core, 'A' + c.addr, c.expected, c.value);
+        } else if (c.core >= 0) {
+            snprintf(op, sizeof(op), "core %d %s %c=%u", c.core, op_type_name(c.type), 'A' + c.addr, c.value);
+        }
+        fprintf(out, "  %3zu  %-15s", t, op);
+
+        for (int k = 0; k < cfg.num_caches; k++) {
+            fprintf(out, " | c%d", k);
+            for (int i = 0; i < cfg.num_addrs; i++) {
+                fprintf(out, " %c:%c", 'A' + i, rp.sys->caches[k]->state_for(addr_of(i)));
+            }
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "  %s\n", r.message.c_str());
+}
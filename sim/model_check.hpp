@@ -0,0 +1,86 @@
+#ifndef MODEL_CHECK_HPP
+#define MODEL_CHECK_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "bus.hpp"
+#include "protocol.hpp"
+
+class System;
+enum class OpType;
+
+struct ModelCheckConfig {
+    int num_caches = 2;       // 2 to 4
+    int num_addrs = 1;        // 1 or 2
+    bool same_set = true;     // two addresses conflict in one cache set
+    int num_values = 2;       // stores write 1..num_values, memory starts at 0
+    uint64_t max_states = 2000000;
+    bool symmetry = true;     // merge states equal up to a core permutation
+    Protocol protocol = Protocol::MESI;
+    uint32_t update_limit = 0; // write-update protocols only
+    bool migratory = false;    // migratory sharing predictor on
+    bool atomics = false;      // also issue SWAP v, CAS v-1 -> v and TAS
+    bool far_atomics = false;
+    BusConfig bus;             // data bus timing; reservations are part of the state
+};
+
+// Explicit-state breadth-first exploration of the real Cache/Bus/System code
+// on a tiny configuration. A transition is one simulated cycle, with at most
+// one op issued to an idle core (every core, op, address and value is tried)
+// or none. Each state is encoded from the caches' lines, in-flight ops,
+// memory and the legal values of in-flight loads; with symmetry on, the
+// per-cache parts are sorted. States are rebuilt by replaying their path
+// from reset, so the search only stores encodings and parent links.
+class ModelChecker {
+public:
+    struct Choice {
+        int core;       // -1: no op issued this cycle
+        OpType type;
+        int addr;       // index into the address set
+        uint8_t value;
+        uint8_t expected;  // CAS only
+    };
+
+    struct Result {
+        uint64_t states = 0;
+        uint64_t transitions = 0;
+        int depth = 0;          // longest shortest path, in cycles
+        bool complete = false;  // false if max_states stopped the search
+        bool violated = false;
+        std::string message;
+        std::vector<Choice> trace; // shortest path to the violation
+    };
+
+    explicit ModelChecker(const ModelCheckConfig& cfg);
+
+    Result run();
+    uint32_t addr_of(int i) const;
+    void print_trace(FILE* out, const Result& r) const;
+
+private:
+    struct Node {
+        int64_t parent;
+        Choice choice;
+        int depth;
+    };
+    struct Replay {
+        std::unique_ptr<System> sys;
+        std::vector<uint8_t> load_legal; // per core, bitmask over values
+    };
+
+    ModelCheckConfig cfg;
+    std::vector<Node> nodes;
+    std::unordered_set<std::string> seen;
+
+    Replay replay(int64_t node) const;
+    void apply(Replay& r, const Choice& c) const;
+    std::string cache_key(const Replay& r, int id) const;
+    std::string encode(const Replay& r) const;
+    std::vector<Choice> path_to(int64_t node) const;
+};
+
+#endif
@@ -0,0 +1,60 @@
+// phase_profile.cpp
+#include "phase_profile.hpp"
+#include "log.hpp"
+
+const char* step_phase_name(StepPhase p){
+    switch (p) {
+        case StepPhase::CoreStep:    return "core step";
+        case StepPhase::Arbitration: return "arbitration";
+        case StepPhase::BusStep:     return "bus step";
+        case StepPhase::SnoopFanout: return "snoop fan-out";
+        case StepPhase::AssertMesi:  return "assert_mesi";
+        case StepPhase::CacheStep:   return "cache step";
+        case StepPhase::IsDone:      return "is_done";
+        case StepPhase::COUNT:       break;
+    }
+    return "?";
+}
+
+void PhaseProfiler::set_enabled(bool on_, uint32_t sample_every){
+    on = on_;
+    every = sample_every ? sample_every : 1;
+    steps = 0;
+    sampled = 0;
+    phase_ticks.fill(0);
+    tick_origin = ticks();
+    wall_origin = std::chrono::steady_clock::now();
+}
+
+uint64_t PhaseProfiler::total_ticks() const {
+    uint64_t sum = 0;
+    for (uint64_t t : phase_ticks) sum += t;
+    return sum;
+}
+
+double PhaseProfiler::ns_per_tick() const {
+#ifdef PHASE_USE_RDTSC
+    uint64_t dt = ticks() - tick_origin;
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - wall_origin).count();
+    return dt ? ns / (double)dt : 0.0;
+#else
+    return 1.0;
+#endif
+}
+
+void PhaseProfiler::print_report() const {
+    uint64_t total = total_ticks();
+    double scale = ns_per_tick();
+
+    printf("\n --- HOST TIME PER STEP PHASE (%llu sampled steps) --- \n",
+        (unsigned long long)sampled);
+    printf("%-14s %8s %12s\n", "phase", "share", "ns/step");
+    for (int p = 0; p < NUM_PHASES; p++) {
+        double share = total ? 100.0 * (double)phase_ticks[p] / (double)total : 0.0;
+        double ns = sampled ? (double)phase_ticks[p] * scale / (double)sampled : 0.0;
+        printf("%-14s %7.1f%% %12.1f\n", step_phase_name((StepPhase)p), share, ns);
+    }
+    printf("%-14s %8s %12.1f\n", "total", "",
+        sampled ? (double)total * scale / (double)sampled : 0.0);
+}
@@ -0,0 +1,83 @@
+#ifndef PHASE_PROFILE_HPP
+#define PHASE_PROFILE_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PHASE_USE_RDTSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PHASE_USE_RDTSC 1
+#endif
+
+enum class StepPhase {
+    CoreStep,
+    Arbitration,
+    BusStep,
+    SnoopFanout,
+    AssertMesi,
+    CacheStep,
+    IsDone,
+    COUNT
+};
+
+// Host-time breakdown of System::step. Disabled it costs one branch per
+// phase; enabled it reads the TSC (steady_clock off x86) at each phase
+// boundary of every sample_every-th step.
+class PhaseProfiler {
+public:
+    static constexpr int NUM_PHASES = (int)StepPhase::COUNT;
+
+    void set_enabled(bool on, uint32_t sample_every = 1);
+    bool enabled() const { return on; }
+
+    void begin_step() {
+        active = on && (++steps % every == 0);
+        if (active) {
+            sampled++;
+            last = ticks();
+        }
+    }
+    void lap(StepPhase p) {
+        if (!active) return;
+        uint64_t t = ticks();
+        phase_ticks[(int)p] += t - last;
+        last = t;
+    }
+
+    uint64_t phase_count(StepPhase p) const { return phase_ticks[(int)p]; }
+    uint64_t total_ticks() const;
+    uint64_t sampled_steps() const { return sampled; }
+    double ns_per_tick() const;
+
+    void print_report() const;
+
+private:
+    bool on = false;
+    bool active = false;
+    uint32_t every = 1;
+    uint64_t steps = 0;
+    uint64_t sampled = 0;
+    uint64_t last = 0;
+    std::array<uint64_t, NUM_PHASES> phase_ticks{};
+
+    // wall clock at enable, used to turn TSC ticks into ns
+    uint64_t tick_origin = 0;
+    std::chrono::steady_clock::time_point wall_origin;
+
+    static uint64_t ticks() {
+#ifdef PHASE_USE_RDTSC
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+};
+
+const char* step_phase_name(StepPhase p);
+
+#endif
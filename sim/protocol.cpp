@@ -0,0 +1,20 @@
+// protocol.cpp
+#include "protocol.hpp"
+#include <cstring>
+
+static const char* const PROTOCOL_NAMES[] = {"mesi", "moesi", "mesif", "dragon", "firefly"};
+static constexpr int NUM_PROTOCOLS = sizeof(PROTOCOL_NAMES) / sizeof(PROTOCOL_NAMES[0]);
+
+const char* protocol_name(Protocol p){
+    return PROTOCOL_NAMES[(int)p];
+}
+
+bool parse_protocol(const char* name, Protocol& out){
+    for (int i = 0; i < NUM_PROTOCOLS; i++) {
+        if (!strcmp(name, PROTOCOL_NAMES[i])) {
+            out = (Protocol)i;
+            return true;
+        }
+    }
+    return false;
+}
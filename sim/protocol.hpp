@@ -0,0 +1,23 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+// coherence protocol run by every cache of a System
+enum class Protocol {
+    MESI,
+    MOESI, // a dirty supplier keeps the line in O; memory stays stale
+    MESIF,  // one clean sharer in F answers BusRd instead of memory
+    DRAGON, // write-update: shared stores broadcast BusUpd, the writer owns (O)
+    FIREFLY // write-update with write-through of shared stores; no owner
+};
+
+// shared stores update the other copies instead of invalidating them
+inline bool is_write_update(Protocol p) { return p == Protocol::DRAGON || p == Protocol::FIREFLY; }
+// a dirty line handed to a reader stays dirty in an owner, so the forward
+// does not write memory
+inline bool has_owner(Protocol p) { return p == Protocol::MOESI || p == Protocol::DRAGON; }
+
+const char* protocol_name(Protocol p);
+// accepts the lower-case names ("mesi", "moesi", "mesif", "dragon", "firefly")
+bool parse_protocol(const char* name, Protocol& out);
+
+#endif
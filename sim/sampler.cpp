@@ -0,0 +1,87 @@
+// sampler.cpp
+#include "sampler.hpp"
+#include "system.hpp"
+#include <cassert>
+#include <cstring>
+
+IntervalSampler::IntervalSampler(uint64_t interval)
+    : every(interval),
+      counter_cols(NUM_COHERENCE_STAT_FIELDS)
+{
+    assert(interval > 0);
+}
+
+void IntervalSampler::sample(const CoherenceStats& s, int stalled_cores){
+    uint64_t span = s.cycles - last_cycle();
+    uint64_t grants = s.bus_grants - last_grants;
+    bus_util_col.push_back(span ? (double)grants / (double)span : 0.0);
+    stalled_col.push_back(stalled_cores);
+    cycle_col.push_back(s.cycles);
+    last_grants = s.bus_grants;
+
+    for (size_t f = 0; f < NUM_COHERENCE_STAT_FIELDS; f++) {
+        counter_cols[f].push_back(s.*COHERENCE_STAT_FIELDS[f].member);
+    }
+}
+
+const std::vector<uint64_t>* IntervalSampler::column(const char* name) const {
+    for (size_t f = 0; f < NUM_COHERENCE_STAT_FIELDS; f++) {
+        if (strcmp(COHERENCE_STAT_FIELDS[f].name, name) == 0) return &counter_cols[f];
+    }
+    return nullptr;
+}
+
+uint64_t IntervalSampler::value(size_t col, size_t row, bool deltas) const {
+    uint64_t v = counter_cols[col][row];
+    if (deltas && row > 0) v -= counter_cols[col][row - 1];
+    return v;
+}
+
+void IntervalSampler::write_csv(FILE* out, bool deltas) const {
+    for (size_t f = 0; f < NUM_COHERENCE_STAT_FIELDS; f++) {
+        fprintf(out, "%s,", COHERENCE_STAT_FIELDS[f].name);
+    }
+    fprintf(out, "bus_util,stalled_cores\n");
+
+    for (size_t r = 0; r < size(); r++) {
+        for (size_t f = 0; f < NUM_COHERENCE_STAT_FIELDS; f++) {
+            fprintf(out, "%llu,", (unsigned long long)value(f, r, deltas));
+        }
+        fprintf(out, "%.4f,%d\n", bus_util_col[r], stalled_col[r]);
+    }
+}
+
+void IntervalSampler::write_json(FILE* out, bool deltas) const {
+    fprintf(out, "{\"interval\":%llu,\"deltas\":%s,\"columns\":{\n",
+        (unsigned long long)every, deltas ? "true" : "false");
+
+    for (size_t f = 0; f < NUM_COHERENCE_STAT_FIELDS; f++) {
+        fprintf(out, "%s\"%s\":[", f ? ",\n" : "", COHERENCE_STAT_FIELDS[f].name);
+        for (size_t r = 0; r < size(); r++) {
+            fprintf(out, "%s%llu", r ? "," : "", (unsigned long long)value(f, r, deltas));
+        }
+        fprintf(out, "]");
+    }
+
+    fprintf(out, ",\n\"bus_util\":[");
+    for (size_t r = 0; r < size(); r++) fprintf(out, "%s%.4f", r ? "," : "", bus_util_col[r]);
+    fprintf(out, "],\n\"stalled_cores\":[");
+    for (size_t r = 0; r < size(); r++) fprintf(out, "%s%d", r ? "," : "", stalled_col[r]);
+    fprintf(out, "]\n}}\n");
+}
+
+bool IntervalSampler::write_csv(const char* path, bool deltas) const {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+    write_csv(out, deltas);
+    fclose(out);
+    return true;
+}
+
+bool IntervalSampler::write_json(const char* path, bool deltas) const {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+    write_json(out, deltas);
+    fclose(out);
+    return true;
+}
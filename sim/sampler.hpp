@@ -0,0 +1,45 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+struct CoherenceStats;
+
+// Snapshots every CoherenceStats counter every `interval` cycles into a
+// columnar buffer, plus per-interval bus utilization and the number of
+// stalled cores at the sample point.
+class IntervalSampler {
+public:
+    explicit IntervalSampler(uint64_t interval);
+
+    uint64_t interval() const { return every; }
+    size_t size() const { return cycle_col.size(); }
+    uint64_t last_cycle() const { return cycle_col.empty() ? 0 : cycle_col.back(); }
+
+    void sample(const CoherenceStats& s, int stalled_cores);
+
+    // counter column by CoherenceStats field name, nullptr if unknown
+    const std::vector<uint64_t>* column(const char* name) const;
+    const std::vector<double>& bus_utilization() const { return bus_util_col; }
+    const std::vector<int>& stalled_cores() const { return stalled_col; }
+
+    // deltas = true writes per-interval increments instead of running totals
+    void write_csv(FILE* out, bool deltas = false) const;
+    void write_json(FILE* out, bool deltas = false) const;
+    bool write_csv(const char* path, bool deltas = false) const;
+    bool write_json(const char* path, bool deltas = false) const;
+
+private:
+    uint64_t every;
+    std::vector<uint64_t> cycle_col;
+    std::vector<std::vector<uint64_t>> counter_cols; // one per COHERENCE_STAT_FIELDS entry
+    std::vector<double> bus_util_col;
+    std::vector<int> stalled_col;
+    uint64_t last_grants = 0;
+
+    uint64_t value(size_t col, size_t row, bool deltas) const;
+};
+
+#endif
@@ -0,0 +1,254 @@
+// stack_distance.cpp
+#include "stack_distance.hpp"
+#include "core.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cassert>
+
+// ---- OrderStatTree ----
+
+void OrderStatTree::grow(uint64_t min_size){
+    uint64_t cap = present.empty() ? 64 : present.size();
+    while (cap < min_size) cap <<= 1;
+    present.resize(cap, 0);
+    rebuild();
+}
+
+void OrderStatTree::reset(uint64_t n){
+    uint64_t cap = 64;
+    while (cap < 2 * n) cap <<= 1;
+    present.assign(cap, 0);
+    present.shrink_to_fit();
+    std::fill(present.begin(), present.begin() + n, 1);
+    live = n;
+    rebuild();
+    tree.shrink_to_fit();
+}
+
+// O(n) from the raw bitmap
+void OrderStatTree::rebuild(){
+    uint64_t cap = present.size();
+    tree.assign(cap + 1, 0);
+    for (uint64_t i = 1; i <= cap; i++) {
+        tree[i] += present[i - 1];
+        uint64_t parent = i + (i & (~i + 1));
+        if (parent <= cap) tree[parent] += tree[i];
+    }
+}
+
+void OrderStatTree::add(uint64_t t, int32_t delta){
+    for (uint64_t i = t; i < tree.size(); i += i & (~i + 1)) {
+        tree[i] += delta;
+    }
+}
+
+uint64_t OrderStatTree::prefix(uint64_t t) const {
+    if (t >= tree.size()) t = tree.size() - 1;
+    int64_t sum = 0;
+    for (uint64_t i = t; i > 0; i -= i & (~i + 1)) {
+        sum += tree[i];
+    }
+    return (uint64_t)sum;
+}
+
+void OrderStatTree::insert(uint64_t t){
+    assert(t > 0);
+    if (t > present.size()) grow(t);
+    assert(!present[t - 1]);
+    present[t - 1] = 1;
+    add(t, 1);
+    live++;
+}
+
+void OrderStatTree::erase(uint64_t t){
+    assert(t > 0 && t <= present.size() && present[t - 1]);
+    present[t - 1] = 0;
+    add(t, -1);
+    live--;
+}
+
+uint64_t OrderStatTree::count_after(uint64_t t) const {
+    if (tree.empty()) return 0;
+    return live - prefix(t);
+}
+
+// ---- StackDistanceProfiler ----
+
+StackDistanceProfiler::StackDistanceProfiler(int num_cores_, uint32_t max_sets_, uint32_t max_ways_)
+    : num_cores(num_cores_), max_sets(max_sets_), max_ways(max_ways_)
+{
+    assert(max_sets && (max_sets & (max_sets - 1)) == 0);
+    uint32_t max_lines = max_sets * max_ways;
+
+    cores.resize(num_cores);
+    for (auto& p : cores) {
+        for (uint32_t s = 1; s <= max_sets; s <<= 1) {
+            Geometry g;
+            g.sets = s;
+            g.stacks.resize(s);
+            g.reuse.hist.assign(max_lines / s, 0);
+            p.geoms.push_back(std::move(g));
+        }
+    }
+}
+
+int StackDistanceProfiler::geom_index(uint32_t sets) const {
+    int g = 0;
+    while ((1u << g) < sets) g++;
+    assert((1u << g) == sets && sets <= max_sets);
+    return g;
+}
+
+void StackDistanceProfiler::touch(Geometry& g, uint32_t line, bool was_invalidated){
+    SetStack& st = g.stacks[line % g.sets];
+    ReuseHistogram& r = g.reuse;
+    r.accesses++;
+
+    // the newest hole is the topmost free way; pushing the stack down
+    // stops there
+    auto it = g.last.find(line);
+    uint64_t hole = st.holes.empty() ? 0 : *st.holes.rbegin();
+    if (it == g.last.end()) {
+        was_invalidated ? r.coherence++ : r.cold++;
+        if (hole) {
+            st.holes.erase(hole);
+            st.tree.erase(hole);
+        }
+    } else {
+        uint64_t d = st.tree.count_after(it->second);
+        d < r.hist.size() ? r.hist[d]++ : r.beyond++;
+        if (hole > it->second) {
+            // caches too small to hold the line fill the hole above it;
+            // in the larger ones the line's old way is now the free one
+            st.holes.erase(hole);
+            st.tree.erase(hole);
+            st.holes.insert(it->second);
+        } else {
+            st.tree.erase(it->second);
+        }
+    }
+
+    // renumber rather than grow while at most half the stamps are live
+    if (st.clock == st.tree.capacity() && st.tree.size() * 2 <= st.clock) compact(g, st);
+
+    uint64_t now = ++st.clock;
+    st.tree.insert(now);
+    if (st.lines.size() < now) st.lines.resize(st.tree.capacity());
+    st.lines[now - 1] = line;
+    g.last[line] = now;
+}
+
+// live stamps keep their order, so every stack distance is unchanged
+void StackDistanceProfiler::compact(Geometry& g, SetStack& st){
+    uint64_t n = 0;
+    std::set<uint64_t> holes;
+    for (uint64_t t = 1; t <= st.clock; t++) {
+        if (!st.tree.contains(t)) continue;
+        uint32_t line = st.lines[t - 1];
+        st.lines[n++] = line;
+        if (st.holes.count(t)) holes.insert(n);
+        else                   g.last[line] = n;
+    }
+    st.holes.swap(holes);
+    st.tree.reset(n);
+    st.lines.resize(st.tree.capacity());
+    st.lines.shrink_to_fit();
+    st.clock = n;
+}
+
+// The invalidated line leaves every stack, but its slot stays as a hole: a
+// free way in every cache large enough to have held it. The next access
+// that misses there, or hits below it, fills the hole instead of pushing
+// the older lines down, so A, B, invalidate B, C, A still hits in 2 ways
+// while a direct-mapped cache that lost A to B still misses. The line's
+// own next access is an infinite-distance coherence miss.
+void StackDistanceProfiler::invalidate(CoreProfile& p, uint32_t line){
+    if (!p.geoms[0].last.count(line)) return;
+    p.invalidated.insert(line);
+    for (auto& g : p.geoms) {
+        auto it = g.last.find(line);
+        g.stacks[line % g.sets].holes.insert(it->second);
+        g.last.erase(it);
+    }
+}
+
+void StackDistanceProfiler::record(int core_id, OpType type, uint32_t addr){
+    assert(core_id >= 0 && core_id < num_cores);
+    uint32_t line = addr / LINE_SIZE;
+    CoreProfile& p = cores[core_id];
+
+    bool was_invalidated = p.invalidated.erase(line) > 0;
+    for (auto& g : p.geoms) {
+        touch(g, line, was_invalidated);
+    }
+
+    // a store (or atomic) takes the line away from every other core
+    if (type != OpType::LOAD) {
+        for (int i = 0; i < num_cores; i++) {
+            if (i != core_id) invalidate(cores[i], line);
+        }
+    }
+}
+
+const ReuseHistogram& StackDistanceProfiler::histogram(int core_id, uint32_t sets) const {
+    assert(core_id >= 0 && core_id < num_cores);
+    return cores[core_id].geoms[geom_index(sets)].reuse;
+}
+
+uint64_t StackDistanceProfiler::accesses(int core_id) const {
+    if (core_id < 0) {
+        uint64_t sum = 0;
+        for (int i = 0; i < num_cores; i++) sum += accesses(i);
+        return sum;
+    }
+    return cores[core_id].geoms[0].reuse.accesses;
+}
+
+uint64_t StackDistanceProfiler::footprint(int core_id) const {
+    assert(core_id >= 0 && core_id < num_cores);
+    uint64_t sum = 0;
+    for (const Geometry& g : cores[core_id].geoms) {
+        for (const SetStack& st : g.stacks) sum += st.tree.capacity();
+    }
+    return sum;
+}
+
+uint64_t StackDistanceProfiler::misses(int core_id, uint32_t sets, uint32_t ways) const {
+    if (core_id < 0) {
+        uint64_t sum = 0;
+        for (int i = 0; i < num_cores; i++) sum += misses(i, sets, ways);
+        return sum;
+    }
+    const ReuseHistogram& r = histogram(core_id, sets);
+    assert(ways >= 1 && ways <= r.hist.size());
+
+    uint64_t m = r.cold + r.coherence + r.beyond;
+    for (size_t d = ways; d < r.hist.size(); d++) {
+        m += r.hist[d];
+    }
+    return m;
+}
+
+double StackDistanceProfiler::miss_ratio(int core_id, uint32_t sets, uint32_t ways) const {
+    uint64_t n = accesses(core_id);
+    if (n == 0) return 0.0;
+    return (double)misses(core_id, sets, ways) / (double)n;
+}
+
+void StackDistanceProfiler::print_miss_ratio_curve(int core_id) const {
+    if (core_id < 0) printf("\n --- MISS RATIO CURVE (all cores) --- \n");
+    else             printf("\n --- MISS RATIO CURVE (core %d) --- \n", core_id);
+
+    printf("%8s", "sets\\ways");
+    for (uint32_t w = 1; w <= max_ways; w <<= 1) printf(" %7u", w);
+    printf("\n");
+
+    for (uint32_t s = 1; s <= max_sets; s <<= 1) {
+        printf("%9u", s);
+        for (uint32_t w = 1; w <= max_ways; w <<= 1) {
+            printf(" %7.4f", miss_ratio(core_id, s, w));
+        }
+        printf("\n");
+    }
+    printf("capacity = sets * ways * %u bytes\n", LINE_SIZE);
+}
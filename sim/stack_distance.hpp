@@ -0,0 +1,97 @@
+#ifndef STACK_DISTANCE_HPP
+#define STACK_DISTANCE_HPP
+
+#include <cstdint>
+#include <set>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "config.hpp"
+
+enum class OpType;
+
+// Fenwick tree over access timestamps. Every line keeps exactly one live
+// stamp (its latest access), and so does every free way an invalidation
+// left, so the number of live stamps newer than a line's previous access
+// is its LRU stack distance. O(log n) per update.
+// The owner renumbers live stamps to 1..n with reset(n) once most stamps
+// are dead, so capacity tracks live lines rather than accesses.
+class OrderStatTree {
+public:
+    void insert(uint64_t t);
+    void erase(uint64_t t);
+    uint64_t count_after(uint64_t t) const;
+    uint64_t size() const { return live; }
+    uint64_t capacity() const { return present.size(); }
+    bool contains(uint64_t t) const { return t > 0 && t <= present.size() && present[t - 1]; }
+    // exactly stamps 1..n live, capacity shrunk to fit them twice over
+    void reset(uint64_t n);
+
+private:
+    std::vector<int32_t> tree;    // 1-based fenwick array
+    std::vector<uint8_t> present; // raw bitmap, used to rebuild on resize
+    uint64_t live = 0;
+
+    void add(uint64_t t, int32_t delta);
+    uint64_t prefix(uint64_t t) const;
+    void grow(uint64_t min_size);
+    void rebuild();
+};
+
+struct ReuseHistogram {
+    std::vector<uint64_t> hist; // hist[d] = accesses with stack distance d (0 = MRU)
+    uint64_t beyond    = 0;     // finite distance >= hist.size()
+    uint64_t cold      = 0;     // first touch of the line
+    uint64_t coherence = 0;     // line was invalidated by a remote store (infinite distance)
+    uint64_t accesses  = 0;
+};
+
+// Single-pass LRU stack distance profiler. Keeps one stack per set for every
+// power-of-two set count up to max_sets, so a single run yields miss counts
+// for any (sets, ways) geometry with sets * ways <= max_sets * max_ways lines.
+class StackDistanceProfiler {
+public:
+    StackDistanceProfiler(int num_cores, uint32_t max_sets = 1024, uint32_t max_ways = 16);
+
+    void record(int core_id, OpType type, uint32_t addr);
+
+    const ReuseHistogram& histogram(int core_id, uint32_t sets) const;
+    uint64_t accesses(int core_id) const;
+    // timestamps allocated over all set stacks; tracks lines, not accesses
+    uint64_t footprint(int core_id) const;
+    uint64_t misses(int core_id, uint32_t sets, uint32_t ways) const;
+    double miss_ratio(int core_id, uint32_t sets, uint32_t ways) const;
+
+    // core_id = -1 sums over all cores
+    void print_miss_ratio_curve(int core_id = -1) const;
+
+private:
+    struct SetStack {
+        OrderStatTree tree;
+        uint64_t clock = 0;
+        std::vector<uint32_t> lines; // line stamped t is lines[t - 1]
+        std::set<uint64_t> holes;    // stamps of invalidated lines' free ways
+    };
+    struct Geometry {
+        uint32_t sets;
+        std::vector<SetStack> stacks;
+        std::unordered_map<uint32_t, uint64_t> last; // line -> stamp in its set
+        ReuseHistogram reuse;
+    };
+    struct CoreProfile {
+        std::vector<Geometry> geoms; // geoms[g].sets == 1 << g
+        std::unordered_set<uint32_t> invalidated;
+    };
+
+    int num_cores;
+    uint32_t max_sets;
+    uint32_t max_ways;
+    std::vector<CoreProfile> cores;
+
+    int geom_index(uint32_t sets) const;
+    void touch(Geometry& g, uint32_t line, bool was_invalidated);
+    void compact(Geometry& g, SetStack& st);
+    void invalidate(CoreProfile& p, uint32_t line);
+};
+
+#endif
@@ -0,0 +1,69 @@
+// stats_export.cpp
+#include "stats_export.hpp"
+#include "system.hpp"
+
+static double core_cpi(const CoreCounters& c){
+    return c.instructions ? (double)c.finish_cycle / (double)c.instructions : 0.0;
+}
+
+void write_stats_json(const System& sys, FILE* out){
+    const CoherenceStats& st = sys.get_stats();
+    fprintf(out, "{\n\"num_cores\": %d,\n\"global\": {", sys.get_num_cores());
+    for (size_t f = 0; f < NUM_COHERENCE_STAT_FIELDS; f++) {
+        fprintf(out, "%s\"%s\": %llu", f ? ", " : "", COHERENCE_STAT_FIELDS[f].name,
+            (unsigned long long)(st.*COHERENCE_STAT_FIELDS[f].member));
+    }
+    fprintf(out, "},\n\"cores\": [");
+    for (int i = 0; i < sys.get_num_cores(); i++) {
+        const CoreCounters& c = sys.get_core_counters(i);
+        fprintf(out, "%s\n  {\"id\": %d", i ? "," : "", i);
+        for (const auto& f : CORE_COUNTER_FIELDS) {
+            fprintf(out, ", \"%s\": %llu", f.name, (unsigned long long)(c.*f.member));
+        }
+        fprintf(out, ", \"cpi\": %.4f}", core_cpi(c));
+    }
+    fprintf(out, "\n],\n\"caches\": [");
+    for (int i = 0; i < sys.get_num_cores(); i++) {
+        const CacheCounters& c = sys.get_cache_counters(i);
+        fprintf(out, "%s\n  {\"id\": %d", i ? "," : "", i);
+        for (const auto& f : CACHE_COUNTER_FIELDS) {
+            fprintf(out, ", \"%s\": %llu", f.name, (unsigned long long)(c.*f.member));
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n]\n}\n");
+}
+
+void write_stats_csv(const System& sys, FILE* out){
+    fprintf(out, "core");
+    for (const auto& f : CORE_COUNTER_FIELDS)  fprintf(out, ",%s", f.name);
+    fprintf(out, ",cpi");
+    for (const auto& f : CACHE_COUNTER_FIELDS) fprintf(out, ",%s", f.name);
+    fprintf(out, "\n");
+
+    for (int i = 0; i < sys.get_num_cores(); i++) {
+        const CoreCounters& c = sys.get_core_counters(i);
+        const CacheCounters& k = sys.get_cache_counters(i);
+        fprintf(out, "%d", i);
+        for (const auto& f : CORE_COUNTER_FIELDS)  fprintf(out, ",%llu", (unsigned long long)(c.*f.member));
+        fprintf(out, ",%.4f", core_cpi(c));
+        for (const auto& f : CACHE_COUNTER_FIELDS) fprintf(out, ",%llu", (unsigned long long)(k.*f.member));
+        fprintf(out, "\n");
+    }
+}
+
+bool write_stats_json(const System& sys, const char* path){
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+    write_stats_json(sys, out);
+    fclose(out);
+    return true;
+}
+
+bool write_stats_csv(const System& sys, const char* path){
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+    write_stats_csv(sys, out);
+    fclose(out);
+    return true;
+}
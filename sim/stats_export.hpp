@@ -0,0 +1,16 @@
+#ifndef STATS_EXPORT_HPP
+#define STATS_EXPORT_HPP
+
+#include <cstdio>
+
+class System;
+
+// JSON: {"num_cores", "global": CoherenceStats, "cores": [...], "caches": [...]}
+void write_stats_json(const System& sys, FILE* out);
+bool write_stats_json(const System& sys, const char* path);
+
+// CSV: one row per core, core counters followed by its cache's counters
+void write_stats_csv(const System& sys, FILE* out);
+bool write_stats_csv(const System& sys, const char* path);
+
+#endif
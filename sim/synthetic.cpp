@@ -0,0 +1,346 @@
+// synthetic.cpp
+#include "synthetic.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// ---- GenRng ----
+
+GenRng::GenRng(uint64_t seed){
+    // splitmix64 so nearby seeds give unrelated streams
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    s = (z ^ (z >> 31)) | 1;
+}
+
+uint64_t GenRng::next(){
+    s ^= s >> 12;
+    s ^= s << 25;
+    s ^= s >> 27;
+    return s * 0x2545f4914f6cdd1dULL;
+}
+
+// ---- SyntheticWorkload ----
+
+SyntheticWorkload::SyntheticWorkload(int num_cores_, uint64_t seed)
+    : num_cores(num_cores_), last(num_cores_, 0), issued(num_cores_, 0)
+{
+    for (int c = 0; c < num_cores; c++) {
+        rngs.emplace_back(seed * 0x100000001b3ULL + (uint64_t)c);
+    }
+}
+
+bool SyntheticWorkload::next(int core, MemOp& op){
+    if (core >= num_cores) return false;
+    op = MemOp{OpType::LOAD, 0, 0};
+    if (!generate(core, last[core], op)) return false;
+    issued[core]++;
+    return true;
+}
+
+void SyntheticWorkload::complete(int core, const MemOp& /*op*/, uint64_t value){
+    if (core < num_cores) last[core] = value;
+}
+
+// ---- RingWorkload ----
+// Layout: tail ticket, head ticket, then the slots, each a sequence byte
+// followed by the item. For ticket t (a byte, so slots must divide 256)
+// the slot is t % slots and the generation g = t / slots; the slot is
+// free for g when seq == 2g and full when seq == 2g+1, mod 2 * 256/slots.
+
+RingWorkload::RingWorkload(int n, const RingConfig& cfg_, uint64_t seed)
+    : SyntheticWorkload(n, seed), cfg(cfg_), th(n)
+{
+    assert(cfg.producers >= 1 && cfg.consumers >= 1);
+    assert(cfg.producers + cfg.consumers <= n);
+    assert(cfg.slots >= 2 && cfg.slots <= 128 && (cfg.slots & (cfg.slots - 1)) == 0);
+    assert((cfg.producers * cfg.items) % cfg.consumers == 0);
+    assert(cfg.slot_stride >= 2);
+    gens = 256 / (uint32_t)cfg.slots;
+}
+
+const char* RingWorkload::name() const {
+    return cfg.producers == 1 && cfg.consumers == 1 ? "spsc" : "mpmc";
+}
+
+uint32_t RingWorkload::seq_addr(uint32_t ticket) const {
+    return cfg.base + 2 * LINE_SIZE + (ticket % (uint32_t)cfg.slots) * cfg.slot_stride;
+}
+
+uint32_t RingWorkload::empty_seq(uint32_t ticket) const {
+    return (2 * (ticket / (uint32_t)cfg.slots)) % (2 * gens);
+}
+
+bool RingWorkload::generate(int core, uint64_t last, MemOp& op){
+    bool producer = core < cfg.producers;
+    if (!producer && core >= cfg.producers + cfg.consumers) return false;
+
+    bool mpmc = cfg.producers > 1 || cfg.consumers > 1;
+    uint32_t ticket_addr = producer ? cfg.base : cfg.base + LINE_SIZE;
+    int quota = producer ? cfg.items : cfg.producers * cfg.items / cfg.consumers;
+    Thread& t = th[core];
+
+    for (;;) {
+        switch (t.step) {
+        case 0:     // take a ticket
+            if (t.done == quota) return false;
+            if (mpmc) {
+                op = MemOp{OpType::FETCH_ADD, ticket_addr, 1};
+                t.step = 1;
+                return true;
+            }
+            t.ticket = (uint32_t)t.done & 0xff;
+            t.step = 2;
+            break;
+        case 1:
+            t.ticket = last & 0xff;
+            t.step = 2;
+            break;
+        case 2:     // poll the slot's sequence byte
+            op = MemOp{OpType::LOAD, seq_addr(t.ticket), 0, 0, 1};
+            t.step = 3;
+            return true;
+        case 3: {
+            uint32_t want = empty_seq(t.ticket) + (producer ? 0 : 1);
+            if (last != want) {
+                spin_count++;
+                op = MemOp{OpType::LOAD, seq_addr(t.ticket), 0, 0, 1};
+                return true;
+            }
+            op = producer ? MemOp{OpType::STORE, seq_addr(t.ticket) + 1, item_value(t.ticket), 0, 1}
+                          : MemOp{OpType::LOAD, seq_addr(t.ticket) + 1, 0, 0, 1};
+            t.step = 4;
+            return true;
+        }
+        case 4:     // publish: full for the consumer, free for the next generation
+            if (!producer) {
+                if (last != item_value(t.ticket)) bad_items++;
+                consumed++;
+            }
+            op = MemOp{OpType::STORE, seq_addr(t.ticket),
+                       producer ? empty_seq(t.ticket) + 1 : (empty_seq(t.ticket) + 2) % (2 * gens), 0, 1};
+            t.step = 5;
+            return true;
+        case 5:
+            t.done++;
+            t.step = 0;
+            break;
+        }
+    }
+}
+
+// ---- ReaderWriterWorkload ----
+
+ReaderWriterWorkload::ReaderWriterWorkload(int n, const SharingConfig& cfg_, uint64_t seed)
+    : SyntheticWorkload(n, seed), cfg(cfg_)
+{
+    assert(cfg.lines >= 1);
+}
+
+const char* ReaderWriterWorkload::name() const { return "rw-sharing"; }
+
+bool ReaderWriterWorkload::generate(int core, uint64_t /*last*/, MemOp& op){
+    if (ops_issued(core) >= (uint64_t)cfg.ops) return false;
+    GenRng& r = rng(core);
+    uint32_t addr = cfg.base + r.below((uint32_t)cfg.lines) * LINE_SIZE;
+    if ((int)r.below(100) < cfg.write_percent) op = MemOp{OpType::STORE, addr, r.below(256)};
+    else                                       op = MemOp{OpType::LOAD, addr, 0};
+    return true;
+}
+
+// ---- ZipfWorkload ----
+
+ZipfWorkload::ZipfWorkload(int n, const ZipfConfig& cfg_, uint64_t seed)
+    : SyntheticWorkload(n, seed), cfg(cfg_), cdf(cfg_.lines)
+{
+    assert(cfg.lines >= 1);
+    double sum = 0;
+    for (int k = 0; k < cfg.lines; k++) {
+        sum += 1.0 / std::pow((double)(k + 1), cfg.theta);
+        cdf[k] = sum;
+    }
+    for (double& p : cdf) p /= sum;
+}
+
+const char* ZipfWorkload::name() const { return "zipf"; }
+
+uint32_t ZipfWorkload::draw(int core){
+    double u = rng(core).uniform();
+    size_t k = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+    return (uint32_t)std::min(k, cdf.size() - 1);
+}
+
+bool ZipfWorkload::generate(int core, uint64_t /*last*/, MemOp& op){
+    if (ops_issued(core) >= (uint64_t)cfg.ops) return false;
+    uint32_t addr = cfg.base + draw(core) * LINE_SIZE;
+    GenRng& r = rng(core);
+    if ((int)r.below(100) < cfg.write_percent) op = MemOp{OpType::STORE, addr, r.below(256)};
+    else                                       op = MemOp{OpType::LOAD, addr, 0};
+    return true;
+}
+
+// ---- StreamWorkload ----
+
+StreamWorkload::StreamWorkload(int n, const StreamConfig& cfg_, uint64_t seed)
+    : SyntheticWorkload(n, seed), cfg(cfg_), pos(n, 0)
+{
+    assert(cfg.stride >= 1 && cfg.region_bytes >= cfg.stride);
+}
+
+const char* StreamWorkload::name() const { return "stream"; }
+
+bool StreamWorkload::generate(int core, uint64_t /*last*/, MemOp& op){
+    uint64_t per_pass = cfg.region_bytes / cfg.stride;
+    if (pos[core] >= per_pass * (uint64_t)cfg.passes) return false;
+
+    uint32_t region = cfg.base + (cfg.shared ? 0 : (uint32_t)core * cfg.region_bytes);
+    uint32_t addr = region + (uint32_t)(pos[core]++ % per_pass) * cfg.stride;
+    GenRng& r = rng(core);
+    if (cfg.store_percent && (int)r.below(100) < cfg.store_percent) op = MemOp{OpType::STORE, addr, r.below(256)};
+    else                                                            op = MemOp{OpType::LOAD, addr, 0};
+    return true;
+}
+
+// ---- BarrierWorkload ----
+// counter at base, sense byte on the next line, private regions after
+
+BarrierWorkload::BarrierWorkload(int n, const BarrierConfig& cfg_, uint64_t seed)
+    : SyntheticWorkload(n, seed), cfg(cfg_), th(n)
+{}
+
+const char* BarrierWorkload::name() const { return "barrier"; }
+
+bool BarrierWorkload::generate(int core, uint64_t last, MemOp& op){
+    static constexpr uint32_t REGION = 16 * LINE_SIZE;
+    uint32_t counter = cfg.base;
+    uint32_t sense = cfg.base + LINE_SIZE;
+    Thread& t = th[core];
+
+    for (;;) {
+        switch (t.step) {
+        case 0:
+            if (t.phase == cfg.phases) return false;
+            if (t.work < cfg.work_ops) {
+                GenRng& r = rng(core);
+                uint32_t addr = cfg.base + REGION * (uint32_t)(core + 1) + r.below(REGION / 4) * 4;
+                t.work++;
+                if ((int)r.below(100) < cfg.store_percent) op = MemOp{OpType::STORE, addr, r.below(256)};
+                else                                       op = MemOp{OpType::LOAD, addr, 0};
+                return true;
+            }
+            t.sense ^= 1;
+            op = MemOp{OpType::FETCH_ADD, counter, 1};
+            t.step = 1;
+            return true;
+        case 1:     // last arrival resets the counter and releases the rest
+            if (last == (uint32_t)(num_cores - 1)) {
+                op = MemOp{OpType::STORE, counter, 0};
+                t.step = 2;
+            } else {
+                op = MemOp{OpType::LOAD, sense, 0};
+                t.step = 3;
+            }
+            return true;
+        case 2:
+            op = MemOp{OpType::STORE, sense, t.sense};
+            t.step = 4;
+            return true;
+        case 3:
+            if (last != t.sense) {
+                spin_count++;
+                op = MemOp{OpType::LOAD, sense, 0};
+                return true;
+            }
+            t.step = 4;
+            break;
+        case 4:
+            t.phase++;
+            t.work = 0;
+            t.step = 0;
+            break;
+        }
+    }
+}
+
+// ---- MigratoryWorkload ----
+
+MigratoryWorkload::MigratoryWorkload(int n, const MigratoryConfig& cfg_, uint64_t seed)
+    : SyntheticWorkload(n, seed), cfg(cfg_), th(n)
+{
+    assert(cfg.objects >= 1 && cfg.reads >= 1);
+}
+
+const char* MigratoryWorkload::name() const { return "migratory"; }
+
+bool MigratoryWorkload::generate(int core, uint64_t last, MemOp& op){
+    Thread& t = th[core];
+    if (t.reads == 0) {
+        if (t.visits == cfg.visits) return false;
+        t.addr = cfg.base + rng(core).below((uint32_t)cfg.objects) * LINE_SIZE;
+    }
+    if (t.reads < cfg.reads) {
+        t.reads++;
+        op = MemOp{OpType::LOAD, t.addr, 0};
+    } else {
+        op = MemOp{OpType::STORE, t.addr, (last + 1) & 0xff};
+        t.reads = 0;
+        t.visits++;
+    }
+    return true;
+}
+
+// ---- FalseSharingWorkload ----
+
+FalseSharingWorkload::FalseSharingWorkload(int n, const FalseSharingConfig& cfg_, uint64_t seed)
+    : SyntheticWorkload(n, seed), cfg(cfg_), done(n, 0)
+{
+    assert(cfg.padding >= 1);
+}
+
+const char* FalseSharingWorkload::name() const {
+    return cfg.padding >= LINE_SIZE ? "padded" : "false-sharing";
+}
+
+bool FalseSharingWorkload::generate(int core, uint64_t last, MemOp& op){
+    int step = done[core];
+    if (step == 2 * cfg.increments) return false;
+    done[core]++;
+    // byte counters, so padding below 4 still gives each core its own
+    if (step % 2 == 0) op = MemOp{OpType::LOAD, counter_addr(core), 0, 0, 1};
+    else               op = MemOp{OpType::STORE, counter_addr(core), (last + 1) & 0xff, 0, 1};
+    return true;
+}
+
+// ---- standard set ----
+
+const char* const SYNTHETIC_WORKLOADS[] = {
+    "spsc", "mpmc", "rw-sharing", "zipf", "stream",
+    "barrier", "migratory", "false-sharing", "padded",
+};
+const size_t NUM_SYNTHETIC_WORKLOADS = sizeof(SYNTHETIC_WORKLOADS) / sizeof(SYNTHETIC_WORKLOADS[0]);
+
+std::unique_ptr<SyntheticWorkload> make_synthetic(const char* name, int n, uint64_t seed){
+    if (!strcmp(name, "spsc") || !strcmp(name, "mpmc")) {
+        if (n < 2) return nullptr;
+        RingConfig cfg;
+        if (!strcmp(name, "mpmc")) {
+            cfg.producers = n / 2;
+            cfg.consumers = n - n / 2;
+            cfg.items = 32 * cfg.consumers;
+        }
+        return std::unique_ptr<SyntheticWorkload>(new RingWorkload(n, cfg, seed));
+    }
+    if (!strcmp(name, "rw-sharing")) return std::unique_ptr<SyntheticWorkload>(new ReaderWriterWorkload(n, SharingConfig(), seed));
+    if (!strcmp(name, "zipf"))       return std::unique_ptr<SyntheticWorkload>(new ZipfWorkload(n, ZipfConfig(), seed));
+    if (!strcmp(name, "stream"))     return std::unique_ptr<SyntheticWorkload>(new StreamWorkload(n, StreamConfig(), seed));
+    if (!strcmp(name, "barrier"))    return std::unique_ptr<SyntheticWorkload>(new BarrierWorkload(n, BarrierConfig(), seed));
+    if (!strcmp(name, "migratory"))  return std::unique_ptr<SyntheticWorkload>(new MigratoryWorkload(n, MigratoryConfig(), seed));
+    if (!strcmp(name, "false-sharing") || !strcmp(name, "padded")) {
+        FalseSharingConfig cfg;
+        cfg.padding = !strcmp(name, "padded") ? LINE_SIZE : 1;
+        return std::unique_ptr<SyntheticWorkload>(new FalseSharingWorkload(n, cfg, seed));
+    }
+    return nullptr;
+}
@@ -0,0 +1,256 @@
+#ifndef SYNTHETIC_HPP
+#define SYNTHETIC_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "config.hpp"
+#include "workload.hpp"
+
+// xorshift64* seeded through splitmix64, one stream per core
+class GenRng {
+public:
+    explicit GenRng(uint64_t seed = 1);
+    uint64_t next();
+    uint32_t below(uint32_t n) { return (uint32_t)(next() % n); }
+    double uniform() { return (double)(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64_t s;
+};
+
+// Base of the synthetic generators. Ops are produced one at a time as
+// cores ask for them, from a per-core stream seeded by (seed, core), so a
+// workload is reproducible from its config and seed alone. Generators
+// that synchronize (rings, barriers) also see each op's returned value.
+class SyntheticWorkload : public Workload {
+public:
+    SyntheticWorkload(int num_cores, uint64_t seed);
+
+    virtual const char* name() const = 0;
+
+    bool next(int core, MemOp& op) override;
+    void complete(int core, const MemOp& op, uint64_t value) override;
+
+    uint64_t ops_issued(int core) const { return issued[core]; }
+
+protected:
+    int num_cores;
+
+    // next op of `core`, given the value its previous op returned
+    virtual bool generate(int core, uint64_t last, MemOp& op) = 0;
+    GenRng& rng(int core) { return rngs[core]; }
+
+private:
+    std::vector<GenRng> rngs;
+    std::vector<uint64_t> last;
+    std::vector<uint64_t> issued;
+};
+
+// Bounded ring with per-slot sequence bytes (Vyukov style). Producers are
+// cores 0..producers-1, consumers the next `consumers` cores. With one of
+// each, tickets are local (SPSC); otherwise they are claimed with
+// FETCH_ADD on shared head/tail words (MPMC). Consumers check every item
+// against the value its ticket implies.
+struct RingConfig {
+    int producers = 1;
+    int consumers = 1;
+    int slots = 16;            // power of two, 2..128
+    int items = 256;           // per producer; the total must split evenly over consumers
+    uint32_t slot_stride = LINE_SIZE; // bytes between slots, < LINE_SIZE packs them
+    uint32_t base = 0x80000;
+};
+
+class RingWorkload : public SyntheticWorkload {
+public:
+    RingWorkload(int num_cores, const RingConfig& cfg, uint64_t seed = 1);
+    const char* name() const override;
+
+    uint64_t items_consumed() const { return consumed; }
+    uint64_t errors() const { return bad_items; }  // consumer read a wrong value
+    uint64_t spins() const { return spin_count; }
+
+protected:
+    bool generate(int core, uint64_t last, MemOp& op) override;
+
+private:
+    struct Thread {
+        int step = 0;
+        int done = 0;       // items produced / consumed
+        uint32_t ticket = 0;
+    };
+    RingConfig cfg;
+    std::vector<Thread> th;
+    uint32_t gens;          // generations before tickets wrap: 256 / slots
+    uint64_t consumed = 0;
+    uint64_t bad_items = 0;
+    uint64_t spin_count = 0;
+
+    uint32_t seq_addr(uint32_t ticket) const;
+    uint32_t empty_seq(uint32_t ticket) const;
+    static uint8_t item_value(uint32_t ticket) { return (uint8_t)(ticket * 7 + 1); }
+};
+
+// Every core reads and writes a small shared set of lines; write_percent
+// tunes how often copies get invalidated.
+struct SharingConfig {
+    int lines = 8;
+    int write_percent = 10;
+    int ops = 1000;           // per core
+    uint32_t base = 0x88000;
+};
+
+class ReaderWriterWorkload : public SyntheticWorkload {
+public:
+    ReaderWriterWorkload(int num_cores, const SharingConfig& cfg, uint64_t seed = 1);
+    const char* name() const override;
+
+protected:
+    bool generate(int core, uint64_t last, MemOp& op) override;
+
+private:
+    SharingConfig cfg;
+};
+
+// Accesses to `lines` shared lines with zipfian popularity: line k is
+// picked with probability proportional to 1 / (k+1)^theta.
+struct ZipfConfig {
+    int lines = 256;
+    double theta = 0.99;
+    int write_percent = 20;
+    int ops = 1000;
+    uint32_t base = 0x90000;
+};
+
+class ZipfWorkload : public SyntheticWorkload {
+public:
+    ZipfWorkload(int num_cores, const ZipfConfig& cfg, uint64_t seed = 1);
+    const char* name() const override;
+
+    // line index the next draw of `core` returns
+    uint32_t draw(int core);
+
+protected:
+    bool generate(int core, uint64_t last, MemOp& op) override;
+
+private:
+    ZipfConfig cfg;
+    std::vector<double> cdf;
+};
+
+// Sequential scans: each core walks its own region (or all cores the same
+// one) `passes` times in `stride`-byte steps.
+struct StreamConfig {
+    uint32_t region_bytes = 4096;
+    uint32_t stride = 4;
+    int passes = 1;
+    bool shared = false;
+    int store_percent = 0;
+    uint32_t base = 0x40000;
+};
+
+class StreamWorkload : public SyntheticWorkload {
+public:
+    StreamWorkload(int num_cores, const StreamConfig& cfg, uint64_t seed = 1);
+    const char* name() const override;
+
+protected:
+    bool generate(int core, uint64_t last, MemOp& op) override;
+
+private:
+    StreamConfig cfg;
+    std::vector<uint64_t> pos;
+};
+
+// Phases of private work separated by a centralized sense-reversing
+// barrier: FETCH_ADD on a counter, the last arrival resets it and flips
+// the sense word the others spin on.
+struct BarrierConfig {
+    int phases = 10;
+    int work_ops = 50;        // private random ops per core per phase
+    int store_percent = 30;
+    uint32_t base = 0xA0000;
+};
+
+class BarrierWorkload : public SyntheticWorkload {
+public:
+    BarrierWorkload(int num_cores, const BarrierConfig& cfg, uint64_t seed = 1);
+    const char* name() const override;
+
+    int phases_done(int core) const { return th[core].phase; }
+    uint64_t spins() const { return spin_count; }
+
+protected:
+    bool generate(int core, uint64_t last, MemOp& op) override;
+
+private:
+    struct Thread {
+        int phase = 0;
+        int work = 0;
+        int step = 0;
+        uint8_t sense = 0;
+    };
+    BarrierConfig cfg;
+    std::vector<Thread> th;
+    uint64_t spin_count = 0;
+};
+
+// Objects handed from core to core: each visit reads a random object
+// `reads` times, then writes it once (read-modify-write, no lock).
+struct MigratoryConfig {
+    int objects = 4;
+    int visits = 100;         // per core
+    int reads = 1;
+    uint32_t base = 0xB0000;
+};
+
+class MigratoryWorkload : public SyntheticWorkload {
+public:
+    MigratoryWorkload(int num_cores, const MigratoryConfig& cfg, uint64_t seed = 1);
+    const char* name() const override;
+
+protected:
+    bool generate(int core, uint64_t last, MemOp& op) override;
+
+private:
+    struct Thread {
+        int visits = 0;
+        int reads = 0;
+        uint32_t addr = 0;
+    };
+    MigratoryConfig cfg;
+    std::vector<Thread> th;
+};
+
+// Per-core counters `padding` bytes apart: 1 packs them all into one line
+// (false sharing), LINE_SIZE gives each its own. Each core increments its
+// own counter with a load and a store, so the final values are exact.
+struct FalseSharingConfig {
+    uint32_t padding = 1;
+    int increments = 200;
+    uint32_t base = 0xC0000;
+};
+
+class FalseSharingWorkload : public SyntheticWorkload {
+public:
+    FalseSharingWorkload(int num_cores, const FalseSharingConfig& cfg, uint64_t seed = 1);
+    const char* name() const override;
+
+    uint32_t counter_addr(int core) const { return cfg.base + (uint32_t)core * cfg.padding; }
+
+protected:
+    bool generate(int core, uint64_t last, MemOp& op) override;
+
+private:
+    FalseSharingConfig cfg;
+    std::vector<int> done;
+};
+
+// The standard set, with default configs: "spsc", "mpmc", "rw-sharing",
+// "zipf", "stream", "barrier", "migratory", "false-sharing", "padded".
+// nullptr for an unknown name.
+std::unique_ptr<SyntheticWorkload> make_synthetic(const char* name, int num_cores, uint64_t seed = 1);
+extern const char* const SYNTHETIC_WORKLOADS[];
+extern const size_t NUM_SYNTHETIC_WORKLOADS;
+
+#endif
@@ -2,8 +2,24 @@
 #include "log.hpp"
 #include "system.hpp"
 #include "core.cpp"
+#include "workload.cpp"
+#include "synthetic.cpp"
+#include "trace_import.cpp"
 #include "cache.cpp"
 #include "memory.cpp"
+#include "protocol.cpp"
+#include "stack_distance.cpp"
+#include "latency.cpp"
+#include "arbiter.cpp"
+#include "migratory.cpp"
+#include "trace_export.cpp"
+#include "sampler.cpp"
+#include "stats_export.cpp"
+#include "phase_profile.cpp"
+#include "coherence_check.cpp"
+#include "golden.cpp"
+#include "fuzz.cpp"
+#include "model_check.cpp"
 #include "config.hpp"
 
 #include <cassert>
@@ -11,20 +27,35 @@
 #include <cstring> 
 #include <vector>
 
-std::vector<int> per_core_counter;
-
-System::System(int num_cores_)
-    : cycle(0), num_cores(num_cores_), rr_next(0)
+System::System(int num_cores_, uint32_t mem_bytes)
+    : latency(num_cores_), arbiter(num_cores_), checker(mem_bytes), cycle(0), num_cores(num_cores_)
     {
-    memory = new Memory(1 << 20);
+    memory = new Memory(mem_bytes);
     bus = new Bus();
 
+    core_counters.resize(num_cores);
+    cache_counters.resize(num_cores);
+    ready_set.resize(num_cores);
+    stalled_set.resize(num_cores);
+    done_set.resize(num_cores);
+    computing_set.resize(num_cores);
+    stall_since.resize(num_cores, 0);
+    load_since.resize(num_cores);
+    load_issue.resize(num_cores, 0);
+    wake_wheel.resize(WAKE_SLOTS);
+
     for (int i = 0; i < num_cores; i++){
         cores.push_back(new Core(i, this));
         caches.push_back(new Cache(i, bus, memory, this));
+        update_core(i);
     }
+}
 
-    per_core_counter.resize(num_cores, 0);
+System::~System() {
+    for (auto* core : cores) delete core;
+    for (auto* cache : caches) delete cache;
+    delete bus;
+    delete memory;
 }
 
 void System::run(uint32_t max_cycles){
@@ -32,15 +63,24 @@ void System::run(uint32_t max_cycles){
     for (cycle = 0; cycle < max_cycles; cycle++){
         step();
         stats.cycles++;
-        for (int i = 0; i < num_cores; i++) {
-            if (core_is_done(i) && per_core_counter[i] == 0){
-                per_core_counter[i] = cycle;
-            }
+        if (sampler && stats.cycles % sampler->interval() == 0) {
+            sampler->sample(stats, stalled_cores());
         }
-        if (is_done())
+        bool done = is_done();
+        phases.lap(StepPhase::IsDone);
+        if (done)
+            break;
+        if (!violations_fatal && has_violation())
             break;
 
     }
+    // close the last partial interval
+    if (sampler && sampler->last_cycle() != stats.cycles) {
+        sampler->sample(stats, stalled_cores());
+    }
+
+    if (!print_report) return;
+
     for (auto* cache : caches) {
         cache->print_cache();
     }
@@ -48,87 +88,209 @@ void System::run(uint32_t max_cycles){
     QUIET = false;
     printf("\n --- DATA ANALYSIS --- \n");
     for (int i = 0; i < num_cores; i++){
-        int core_cycles = per_core_counter[i];
-        int core_instructions = cores[i]->trace_size();
+        uint64_t core_cycles = core_counters[i].finish_cycle;
+        uint64_t core_instructions = core_counters[i].instructions;
         double core_cpi = (double)(core_cycles)/(double)(core_instructions);
-        printf("Core %i- CPI: %.2f, cycles: %i, trace size: %i\n", i, core_cpi, core_cycles, core_instructions);
+        printf("Core %i- CPI: %.2f, cycles: %llu, instructions: %llu\n", i, core_cpi,
+            (unsigned long long)core_cycles, (unsigned long long)core_instructions);
 
     }
     double cpi = (double)stats.cycles / stats.instructions;
     double bus_rdx_per_inst = (double)stats.bus_rdx / stats.instructions;
     double stall_ratio = ((double)stats.stall_cycles / stats.cycles);
-    printf("Cores: %d\n", num_cores);
+    printf("Cores: %d, protocol: %s\n", num_cores, protocol_name(protocol));
     printf("CPI: %.2f\n", cpi);
     printf("BusRdX / inst: %.3f\n", bus_rdx_per_inst);
     printf("Invalidations: %i\n", stats.invalidations);
+    printf("Evictions: %i, dirty writebacks: %i\n", stats.evictions, stats.writebacks);
+    if (has_owner(protocol)) {
+        printf("Writebacks avoided by owners: %llu\n", (unsigned long long)stats.writebacks_avoided);
+    }
+    if (protocol == Protocol::MESIF) {
+        // the default bus gives both sources the same latency, so only a
+        // configured c2c_latency below mem_latency shows a saving here
+        const BusTraffic& bt = bus->traffic();
+        const BusConfig& bc = bus->config();
+        double saved = bt.c2c_lines && bt.mem_lines
+            ? (double)bt.mem_fill_cycles / bt.mem_lines - (double)bt.c2c_fill_cycles / bt.c2c_lines : 0.0;
+        printf("Memory reads avoided by forwarders: %llu, cache fills %.2f cycles faster than memory fills%s\n",
+            (unsigned long long)stats.mem_reads_avoided, saved,
+            bc.c2c_latency == bc.mem_latency ? " (c2c_latency == mem_latency: no latency benefit)" : "");
+    }
     printf("Avg stalled cores per cycle: %.2f\n", stall_ratio);
     printf("BusRd #: %i, BusRdX #: %i, BusUpgr #: %i\n", stats.bus_rd, stats.bus_rdx, stats.bus_upgr);
+    if (is_write_update(protocol)) {
+        printf("BusUpd #: %llu, word updates delivered: %llu (%llu read, %llu wasted), competitive fallbacks: %llu\n",
+            (unsigned long long)stats.bus_upd, (unsigned long long)stats.updates_delivered,
+            (unsigned long long)stats.updates_useful, (unsigned long long)stats.updates_wasted,
+            (unsigned long long)stats.update_fallbacks);
+    }
+    if (stats.compute_instructions) {
+        printf("Non-memory instructions: %llu (IPC %.2f)\n",
+            (unsigned long long)stats.compute_instructions, compute_ipc);
+    }
+    if (stats.width_1b + stats.width_2b + stats.width_8b + stats.width_16b + stats.width_32b) {
+        printf("Access widths: 1B %llu, 2B %llu, 4B %llu, 8B %llu, 16B %llu, 32B %llu; line-crossing: %llu\n",
+            (unsigned long long)stats.width_1b, (unsigned long long)stats.width_2b,
+            (unsigned long long)stats.width_4b, (unsigned long long)stats.width_8b,
+            (unsigned long long)stats.width_16b, (unsigned long long)stats.width_32b,
+            (unsigned long long)stats.split_accesses);
+    }
+    if (stats.atomics) {
+        printf("Atomics: %llu (%llu failed), far: %llu\n", (unsigned long long)stats.atomics,
+            (unsigned long long)stats.atomic_failures, (unsigned long long)stats.far_atomics);
+    }
+    if (migratory_on) {
+        printf("Migratory grants: %llu, upgrades avoided: %llu, mispredictions: %llu\n",
+            (unsigned long long)stats.migratory_grants, (unsigned long long)stats.upgrades_avoided,
+            (unsigned long long)stats.migratory_mispredicts);
+    }
     printf("Hits: %i, Misses: %i\n", stats.hits, stats.misses);
+    printf("Loads checked against golden memory: %llu (%llu past history window)\n",
+        (unsigned long long)golden.loads_checked(), (unsigned long long)golden.loads_unchecked());
+    const BusTraffic& bt = bus->traffic();
+    printf("Data bus utilization: %.1f%% (%llu c2c lines, %llu memory lines, %llu writebacks, %llu address-only, %llu cycles queued)\n",
+        100.0 * bus->utilization(stats.cycles),
+        (unsigned long long)bt.c2c_lines, (unsigned long long)bt.mem_lines,
+        (unsigned long long)bt.writeback_lines, (unsigned long long)bt.addr_only,
+        (unsigned long long)bt.queued_cycles);
+    printf("Line fills: %llu from caches (mean %.2f cycles), %llu from memory (mean %.2f cycles)\n",
+        (unsigned long long)bt.c2c_lines, bt.c2c_lines ? (double)bt.c2c_fill_cycles / bt.c2c_lines : 0.0,
+        (unsigned long long)bt.mem_lines, bt.mem_lines ? (double)bt.mem_fill_cycles / bt.mem_lines : 0.0);
+    latency.print_summary();
+    arbiter.print_summary(ready_set, now());
+    if (phases.enabled()) phases.print_report();
 }
 
 void System::step(){
     
     // printf("\nCycle: %i\n\n", cycle);
-    // advance cores
-    for (auto* core : cores) {
-        core->step();
-    }
+    phases.begin_step();
 
-    // arbritration - allow 1 cache onto bus
-    bool issued = false;
-    for (int i = 0; i < num_cores; i++){
-        int k = (rr_next + i) % num_cores;
+    // advance cores retiring non-memory instructions
+    computing_set.for_each([&](int k) {
+        cores[k]->step();
+    });
+    phases.lap(StepPhase::CoreStep);
 
+    // arbritration - allow 1 cache onto bus
+    // ready cores have an op and an idle cache, so the arbiter's pick wins;
+    // the only refusal is a busy bus, which refuses everyone
+    stats.stall_cycles += stalled_set.count();
+    int k = arbiter.pick(ready_set);
+    if (k >= 0) {
         Core* core = cores[k];
         Cache* cache = caches[k];
-        if (core->is_stalled()) {
-            record_stall_cycle();
-        }
-
-        if (core->has_request() && !core->is_stalled()){
-            if (cache->accept_request(core, core->current_op())){
-                printf("[ARB] Cycle %u winner = core %d\n", cycle, k);
-                rr_next = (k + 1) % num_cores;
-                issued = true;
-                break;  
+        MemOp op = core->current_op();
+        char state = coverage ? cache->state_for(op.addr) : 'I';
+        char victim = coverage ? cache->victim_for(op.addr) : 'I';
+        if (cache->accept_request(core, op)){
+            if (coverage) coverage->accept(op.addr, state, op.type, victim);
+            if (op.type == OpType::LOAD) {
+                golden.versions(op.addr, op.size, load_since[k].data());
+                load_issue[k] = now();
             }
+            if (profiler) profiler->record(k, op.type, op.addr);
+            printf("[ARB] Cycle %u winner = core %d\n", cycle, k);
+            arbiter.on_grant(k, now());
+            if (tracer) tracer->arbitration(k, arbiter.next(), now());
         }
-        
     }
+    phases.lap(StepPhase::Arbitration);
     
     // advance bus and allow snooping
     BusGrant grant;
     if (bus->step(grant)) {
+        stats.bus_grants++;
+        phases.lap(StepPhase::BusStep);
 
         bool supplied = false;
+        // BusUpgr, a BusUpd to a line the writer holds and far atomics move
+        // no line to the requester; a far atomic still drains a dirty copy
+        bool far = grant.req.type == BusReqType::BusAtomic;
+        bool fill = grant.req.type != BusReqType::BusUpgr && !far
+            && caches[grant.req.cache_id]->state_for(grant.req.addr) == 'I';
+        bool track_migratory = migratory_on && !is_write_update(protocol);
+        if (track_migratory && grant.req.type == BusReqType::BusRd && migratory.predict(grant.req.addr)) {
+            grant.req.exclusive = true;
+            stats.migratory_grants++;
+        }
+        int other_copies = 0;
 
         for (auto* cache : caches) {
+            if (coverage && cache->id() != grant.req.cache_id) {
+                coverage->snoop(grant.req.addr, cache->state_for(grant.req.addr), grant.req.type);
+            }
             auto res = cache->snoop_and_update(grant.req);
+            if (tracer && cache->id() != grant.req.cache_id) {
+                tracer->snoop(cache->id(), grant.req, res.had_line, res.was_dirty, now());
+            }
             
             if (cache->id() != grant.req.cache_id){
                 grant.shared |= res.had_line;
+                other_copies += res.had_line;
                 // if dirty, data must be supplied
-                if (res.was_dirty && !supplied) {
+                if (res.was_dirty && (fill || far) && !supplied) {
+                    cache_counters[cache->id()].supplied++;
                     memcpy(grant.data, res.data, LINE_SIZE);
                     supplied = true;
                     grant.flush = true;
-                    memory->write_line(grant.req.addr, grant.data);
+                    // MOESI/Dragon: the owner (or the new M copy) stays responsible
+                    if (has_owner(protocol) && !far) stats.writebacks_avoided++;
+                    else memory->write_line(grant.req.addr, grant.data);
+                } else if (res.forwards && fill && !supplied) {
+                    cache_counters[cache->id()].supplied++;
+                    memcpy(grant.data, res.data, LINE_SIZE);
+                    supplied = true;
+                    grant.forwarded = true;
+                    stats.mem_reads_avoided++;
                 }
             }
             
         }
         if (!supplied) {
             memory->read_line(grant.req.addr, grant.data);
-            // grant.flush stays false
+            // grant.flush and grant.forwarded stay false
+        }
+        if (track_migratory) {
+            if (grant.req.type == BusReqType::BusRd) {
+                migratory.on_read(grant.req.addr, grant.req.cache_id, grant.flush);
+            } else if (grant.req.type == BusReqType::BusUpgr) {
+                migratory.on_upgrade(grant.req.addr, grant.req.cache_id, other_copies);
+            }
         }
-        assert_mesi(grant.req.addr);
+        if (grant.req.type == BusReqType::BusUpd && grant.shared && protocol == Protocol::FIREFLY) {
+            // Firefly writes shared stores through, so sharers stay clean
+            uint8_t line[LINE_SIZE];
+            memory->read_line(grant.req.addr, line);
+            fill_bytes(&line[grant.req.addr % LINE_SIZE], grant.req.data, grant.req.size);
+            memory->write_line(grant.req.addr, line);
+        }
+        bool writeback = fill && strchr("MO", caches[grant.req.cache_id]->victim_for(grant.req.addr));
+        bus->schedule(grant, fill, writeback, now());
+        if (tracer) tracer->bus_grant(grant.req, grant.shared, grant.flush, now());
+        if (coverage) coverage->grant(grant.req.addr, grant.req.type, grant.shared, grant.flush || grant.forwarded);
+        phases.lap(StepPhase::SnoopFanout);
+
         caches[grant.req.cache_id] -> on_bus_grant(grant);
-    }
+        phases.lap(StepPhase::BusStep);
 
-    // advance caches
-    for (auto* cache : caches) {
-        cache->step();
+        if (checker.is_paranoid()) checker.full_scan(caches);
+        phases.lap(StepPhase::AssertMesi);
     }
+    phases.lap(StepPhase::BusStep);
+
+    // advance caches whose op is due this cycle
+    std::vector<std::pair<uint64_t, int>>& slot = wake_wheel[now() & (WAKE_SLOTS - 1)];
+    if (!slot.empty()) {
+        due.swap(slot);
+        for (auto& w : due) {
+            if (w.first > now()) slot.push_back(w); // a full wheel turn away
+            else                 caches[w.second]->step();
+        }
+        due.clear();
+    }
+    phases.lap(StepPhase::CacheStep);
     
 }
 
@@ -144,34 +306,46 @@ Cache* System::get_cache(int id) {
 }
 
 bool System::is_done() {
-    for (auto* core : cores) {
-        if (!core->is_finished() || core->is_stalled())
-            return false;
-    }
-
-    for (auto* cache : caches) {
-        if (cache->is_busy())
-            return false;
-    }
-
-    if (bus->is_busy())
-        return false;
-
-    return true;
+    // a core is done once it retired its last op; its cache is idle then
+    return done_set.count() == num_cores && !bus->is_busy();
 }
 
 bool System::core_is_done(int i) {
+    return done_set.test(i);
+}
 
-    if (!cores[i]->is_finished() || cores[i]->is_stalled())
-            return false;
-    
-
-    if (caches[i]->is_busy())
-        return false;
-
-    return true;
+// Called by a core whenever its stall flag or remaining trace changes, so
+// the ready/stalled/done sets never need a per-cycle scan.
+void System::update_core(int id) {
+    Core* c = cores[id];
+    bool stalled = c->is_stalled();
+    bool finished = c->is_finished();
+    bool computing = c->is_computing();
+
+    if (stalled != stalled_set.test(id)) {
+        if (stalled) {
+            stall_since[id] = now();
+        } else {
+            core_counters[id].stall_cycles += now() - stall_since[id];
+        }
+        stalled_set.assign(id, stalled);
+    }
+    computing_set.assign(id, computing);
+    bool ready = !stalled && !finished && !computing;
+    if (ready && !ready_set.test(id)) arbiter.on_ready(id, now());
+    ready_set.assign(id, ready);
+
+    bool done = !stalled && finished;
+    if (done && !done_set.test(id)) {
+        // cycle count once the current step retires
+        core_counters[id].finish_cycle = now() + 1;
+    }
+    done_set.assign(id, done);
 }
 
+void System::schedule_cache(int cache_id, uint64_t at) {
+    wake_wheel[at & (WAKE_SLOTS - 1)].push_back({at, cache_id});
+}
 
 void System::assert_mesi(uint32_t addr){
     int m_count = 0;
@@ -197,33 +371,310 @@ void System::assert_mesi(uint32_t addr){
     
 }
 
-void System::record_instruction_retired() {
-    stats.instructions++;
+void System::record_state_change(int cache_id, uint32_t addr, char from, char to){
+    checker.on_transition(cache_id, addr, from, to);
+}
+
+void System::record_protocol_error(int cache_id, uint32_t addr, const char* what){
+    checker.report(cache_id, addr, what);
+}
+
+void System::set_paranoid_check(bool on) {
+    checker.set_paranoid(on);
+}
+
+const CoherenceChecker& System::get_checker() const {
+    return checker;
+}
+
+void System::record_store_performed(int cache_id, uint32_t addr, const uint8_t* bytes, int size){
+    golden.store(cache_id, addr, bytes, size, now());
+}
+
+void System::check_load(int core_id, uint32_t addr, const uint8_t* bytes, int size){
+    if (!golden.check_load(core_id, addr, bytes, size, load_since[core_id].data(), load_issue[core_id], now())
+        && violations_fatal) {
+        fprintf(stderr, "%s\n", GoldenMemory::describe(golden.first_stale()).c_str());
+        exit(1);
+    }
+}
+
+void System::set_violations_fatal(bool on) {
+    violations_fatal = on;
+    checker.set_fatal(on);
+}
+
+bool System::has_violation() const {
+    return checker.violations() > 0 || golden.stale_reads() > 0;
+}
+
+std::string System::violation_message() const {
+    if (checker.violations()) return checker.first_violation();
+    if (golden.stale_reads()) return GoldenMemory::describe(golden.first_stale());
+    return "";
+}
+
+const GoldenMemory& System::get_golden() const {
+    return golden;
+}
+
+const CoherenceStats& System::get_stats() const {
+    return stats;
+}
+
+const CoreCounters& System::get_core_counters(int id) const {
+    assert(id >= 0 && id < num_cores);
+    return core_counters[id];
+}
+
+const CacheCounters& System::get_cache_counters(int id) const {
+    assert(id >= 0 && id < num_cores);
+    return cache_counters[id];
+}
+
+int System::get_num_cores() const {
+    return num_cores;
+}
+
+void System::set_print_report(bool on) {
+    print_report = on;
+}
+
+void System::enable_phase_profile(bool on, uint32_t sample_every) {
+    phases.set_enabled(on, sample_every);
+}
+
+const PhaseProfiler& System::get_phase_profile() const {
+    return phases;
+}
+
+void System::attach_profiler(StackDistanceProfiler* p) {
+    profiler = p;
+}
+
+void System::attach_tracer(TraceExporter* t) {
+    tracer = t;
+}
+
+void System::attach_sampler(IntervalSampler* s) {
+    sampler = s;
+}
+
+void System::attach_workload(Workload* w) {
+    for (auto* core : cores) core->set_workload(w);
+}
+
+void System::attach_coverage(TransitionCoverage* c) {
+    coverage = c;
+}
+
+int System::stalled_cores() const {
+    return stalled_set.count();
+}
+
+const LatencyStats& System::get_latency() const {
+    return latency;
+}
+
+void System::print_latency_report() const {
+    latency.print_report();
+}
+
+void System::set_protocol(Protocol p) {
+    protocol = p;
+    for (auto* cache : caches) cache->set_protocol(p);
+}
+
+Protocol System::get_protocol() const {
+    return protocol;
+}
+
+void System::set_update_limit(uint32_t k) {
+    for (auto* cache : caches) cache->set_update_limit(k);
+}
+
+void System::set_migratory_sharing(bool on, uint32_t entries, uint32_t threshold) {
+    migratory_on = on;
+    migratory.set_entries(entries);
+    migratory.set_threshold(threshold);
+}
+
+const MigratoryPredictor& System::get_migratory() const {
+    return migratory;
+}
+
+void System::set_far_atomics(bool on) {
+    for (auto* cache : caches) cache->set_far_atomics(on);
+}
+
+void System::set_compute_ipc(double ipc) {
+    assert(ipc > 0);
+    compute_ipc = ipc;
+}
+
+double System::get_compute_ipc() const {
+    return compute_ipc;
 }
 
-void System::record_bus_rd() {
+void System::configure_bus(const BusConfig& c) {
+    bus->configure(c);
+}
+
+const Bus& System::get_bus() const {
+    return *bus;
+}
+
+Arbiter& System::get_arbiter() {
+    return arbiter;
+}
+
+const Arbiter& System::get_arbiter() const {
+    return arbiter;
+}
+
+void System::print_arbitration_report() const {
+    arbiter.print_report(ready_set, now());
+}
+
+int System::starving_cores() const {
+    return arbiter.starving(ready_set, now());
+}
+
+uint64_t System::now() const {
+    return stats.cycles;
+}
+
+void System::record_instruction_retired(int core_id, const MemOp& op) {
+    uint64_t count = op.type == OpType::COMPUTE ? op.data : 1;
+    stats.instructions += count;
+    core_counters[core_id].instructions += count;
+    if (op.type == OpType::LOAD)       core_counters[core_id].loads++;
+    else if (op.type == OpType::STORE) core_counters[core_id].stores++;
+    else if (is_atomic(op.type))       core_counters[core_id].atomics++;
+    else {
+        core_counters[core_id].compute += count;
+        stats.compute_instructions += count;
+        return;
+    }
+    uint64_t CoherenceStats::* widths[6] = {
+        &CoherenceStats::width_1b, &CoherenceStats::width_2b, &CoherenceStats::width_4b,
+        &CoherenceStats::width_8b, &CoherenceStats::width_16b, &CoherenceStats::width_32b};
+    int w = 0;
+    while (w < 5 && (1 << w) < op.size) w++;
+    stats.*widths[w] += 1;
+    if (crosses_line(op)) {
+        stats.split_accesses++;
+        core_counters[core_id].split++;
+    }
+}
+
+void System::record_bus_rd(int cache_id) {
     stats.bus_rd++;
+    cache_counters[cache_id].bus_rd++;
 }
 
-void System::record_bus_rdx() {
+void System::record_bus_rdx(int cache_id) {
     stats.bus_rdx++;
+    cache_counters[cache_id].bus_rdx++;
 }
 
-void System::record_bus_upgr() {
+void System::record_bus_upgr(int cache_id) {
     stats.bus_upgr++;
+    cache_counters[cache_id].bus_upgr++;
+}
+
+void System::record_bus_upd(int cache_id) {
+    stats.bus_upd++;
+    cache_counters[cache_id].bus_upd++;
 }
 
-void System::record_invalidation() {
+void System::record_update_delivered(int cache_id, bool overwrote_unread) {
+    stats.updates_delivered++;
+    cache_counters[cache_id].updates_delivered++;
+    if (overwrote_unread) {
+        stats.updates_wasted++;
+        cache_counters[cache_id].updates_wasted++;
+    }
+}
+
+void System::record_update_read(int cache_id, bool useful) {
+    if (useful) {
+        stats.updates_useful++;
+        cache_counters[cache_id].updates_useful++;
+    } else {
+        stats.updates_wasted++;
+        cache_counters[cache_id].updates_wasted++;
+    }
+}
+
+void System::record_updates_dropped(int cache_id, int words) {
+    stats.updates_wasted += words;
+    cache_counters[cache_id].updates_wasted += words;
+}
+
+void System::record_update_fallback(int cache_id) {
+    stats.update_fallbacks++;
+    cache_counters[cache_id].update_fallbacks++;
+}
+
+void System::record_upgrade_avoided(int cache_id) {
+    stats.upgrades_avoided++;
+    cache_counters[cache_id].upgrades_avoided++;
+}
+
+void System::record_migratory_mispredict(int cache_id, uint32_t addr) {
+    stats.migratory_mispredicts++;
+    cache_counters[cache_id].migratory_mispredicts++;
+    migratory.on_mispredict(addr);
+}
+
+void System::record_far_atomic(int cache_id) {
+    stats.far_atomics++;
+    cache_counters[cache_id].bus_atomic++;
+}
+
+void System::record_atomic_performed(int cache_id, const MemOp& op, uint64_t old) {
+    stats.atomics++;
+    uint64_t unused;
+    if (!op_result(op, old, unused) || (op.type == OpType::TAS && old != 0)) {
+        stats.atomic_failures++;
+    }
+    // nothing may come between the read and the write
+    uint8_t bytes[8];
+    fill_bytes(bytes, old, op.size);
+    if (!golden.check_load(cache_id, op.addr, bytes, op.size, nullptr, now(), now())
+        && violations_fatal) {
+        fprintf(stderr, "%s\n", GoldenMemory::describe(golden.first_stale()).c_str());
+        exit(1);
+    }
+}
+
+void System::record_invalidation(int cache_id, uint32_t addr) {
     stats.invalidations++;
+    cache_counters[cache_id].invalidations++;
+    if (tracer) tracer->invalidation(cache_id, addr, now());
+}
+
+void System::record_eviction(int cache_id, uint32_t addr, bool dirty) {
+    stats.evictions++;
+    cache_counters[cache_id].evictions++;
+    if (dirty) {
+        stats.writebacks++;
+        cache_counters[cache_id].writebacks++;
+    }
+    if (tracer) tracer->eviction(cache_id, addr, dirty, now());
 }
 
-void System::record_stall_cycle() {
-    stats.stall_cycles++;
+void System::record_latency(int core_id, const MemOp& op, bool hit, LatencyReq req, uint64_t cycles) {
+    latency.record(core_id, op.type, hit, req, cycles);
+    if (tracer) tracer->op_span(core_id, op.type, op.addr, op.data, hit, req, now() - cycles, now());
 }
 
-void System::record_miss(){
+void System::record_miss(int cache_id){
     stats.misses++;
+    cache_counters[cache_id].misses++;
 }
-void System::record_hit(){
+void System::record_hit(int cache_id){
     stats.hits++;
+    cache_counters[cache_id].hits++;
 }
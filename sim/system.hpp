@@ -5,11 +5,37 @@
 #include <iostream>
 #include <cstdint>
 #include "core.hpp"
+#include "workload.hpp"
+#include "synthetic.hpp"
+#include "trace_import.hpp"
 #include "cache.hpp"
 #include "bus.cpp"
+#include "stack_distance.hpp"
+#include "latency.hpp"
+#include "trace_export.hpp"
+#include "sampler.hpp"
+#include "stats_export.hpp"
+#include "phase_profile.hpp"
+#include "core_set.hpp"
+#include "arbiter.hpp"
+#include "migratory.hpp"
+#include "coherence_check.hpp"
+#include "golden.hpp"
+#include "fuzz.hpp"
+#include "model_check.hpp"
 struct CoherenceStats {
     uint64_t cycles = 0;
     uint64_t instructions = 0;
+    uint64_t compute_instructions = 0; // non-memory, from COMPUTE ops
+
+    // memory ops by access width, rounded up to a power of two
+    uint64_t width_1b = 0;
+    uint64_t width_2b = 0;
+    uint64_t width_4b = 0;
+    uint64_t width_8b = 0;
+    uint64_t width_16b = 0;
+    uint64_t width_32b = 0;
+    uint64_t split_accesses = 0;   // crossed a line, issued as two transactions
 
     uint64_t hits = 0;
     uint64_t misses = 0;
@@ -17,9 +43,148 @@ struct CoherenceStats {
     uint64_t bus_rd = 0;
     uint64_t bus_rdx = 0;
     uint64_t bus_upgr = 0;
+    uint64_t bus_upd = 0;
     uint64_t invalidations = 0;
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+    uint64_t writebacks_avoided = 0; // dirty forwards an owner kept (MOESI, Dragon)
+    uint64_t mem_reads_avoided = 0;  // clean forwards from a peer (MESIF)
+
+    // write-update, counted per word and per receiving copy
+    uint64_t updates_delivered = 0;
+    uint64_t updates_useful = 0;     // read here before being overwritten or dropped
+    uint64_t updates_wasted = 0;
+    uint64_t update_fallbacks = 0;   // copies invalidated by the competitive limit
+
+    // migratory sharing
+    uint64_t migratory_grants = 0;      // BusRds answered with ownership
+    uint64_t upgrades_avoided = 0;      // of those, written without another transaction
+    uint64_t migratory_mispredicts = 0; // read elsewhere or evicted before the write
+
+    // atomics
+    uint64_t atomics = 0;          // performed, near or far
+    uint64_t atomic_failures = 0;  // CAS mismatches and TAS that found the byte set
+    uint64_t far_atomics = 0;      // performed at memory (BusAtomic)
+
+    uint64_t bus_grants = 0;
+
+    uint64_t stall_cycles = 0;
+};
 
+// name -> counter table, so samplers and exporters see every field
+struct StatField {
+    const char* name;
+    uint64_t CoherenceStats::* member;
+};
+inline constexpr StatField COHERENCE_STAT_FIELDS[] = {
+    {"cycles",        &CoherenceStats::cycles},
+    {"instructions",  &CoherenceStats::instructions},
+    {"compute_instructions", &CoherenceStats::compute_instructions},
+    {"width_1b",      &CoherenceStats::width_1b},
+    {"width_2b",      &CoherenceStats::width_2b},
+    {"width_4b",      &CoherenceStats::width_4b},
+    {"width_8b",      &CoherenceStats::width_8b},
+    {"width_16b",     &CoherenceStats::width_16b},
+    {"width_32b",     &CoherenceStats::width_32b},
+    {"split_accesses", &CoherenceStats::split_accesses},
+    {"hits",          &CoherenceStats::hits},
+    {"misses",        &CoherenceStats::misses},
+    {"bus_rd",        &CoherenceStats::bus_rd},
+    {"bus_rdx",       &CoherenceStats::bus_rdx},
+    {"bus_upgr",      &CoherenceStats::bus_upgr},
+    {"bus_upd",       &CoherenceStats::bus_upd},
+    {"invalidations", &CoherenceStats::invalidations},
+    {"evictions",     &CoherenceStats::evictions},
+    {"writebacks",    &CoherenceStats::writebacks},
+    {"writebacks_avoided", &CoherenceStats::writebacks_avoided},
+    {"mem_reads_avoided",  &CoherenceStats::mem_reads_avoided},
+    {"updates_delivered",  &CoherenceStats::updates_delivered},
+    {"updates_useful",     &CoherenceStats::updates_useful},
+    {"updates_wasted",     &CoherenceStats::updates_wasted},
+    {"update_fallbacks",   &CoherenceStats::update_fallbacks},
+    {"migratory_grants",   &CoherenceStats::migratory_grants},
+    {"upgrades_avoided",   &CoherenceStats::upgrades_avoided},
+    {"migratory_mispredicts", &CoherenceStats::migratory_mispredicts},
+    {"atomics",            &CoherenceStats::atomics},
+    {"atomic_failures",    &CoherenceStats::atomic_failures},
+    {"far_atomics",        &CoherenceStats::far_atomics},
+    {"bus_grants",    &CoherenceStats::bus_grants},
+    {"stall_cycles",  &CoherenceStats::stall_cycles},
+};
+inline constexpr size_t NUM_COHERENCE_STAT_FIELDS =
+    sizeof(COHERENCE_STAT_FIELDS) / sizeof(COHERENCE_STAT_FIELDS[0]);
+
+// Per-core and per-cache counters. Each struct fills whole host cache lines
+// so counters of different cores never share one.
+struct alignas(HOST_CACHE_LINE) CoreCounters {
+    uint64_t instructions = 0;
+    uint64_t loads = 0;
+    uint64_t stores = 0;
+    uint64_t atomics = 0;
+    uint64_t compute = 0;      // non-memory instructions
     uint64_t stall_cycles = 0;
+    uint64_t finish_cycle = 0; // cycle at which the core last drained its trace
+    uint64_t split = 0;        // memory ops that crossed a line (two transactions)
+};
+
+struct alignas(HOST_CACHE_LINE) CacheCounters {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t bus_rd = 0;
+    uint64_t bus_rdx = 0;
+    uint64_t bus_upgr = 0;
+    uint64_t bus_upd = 0;
+    uint64_t bus_atomic = 0;
+    uint64_t invalidations = 0; // copies this cache lost to remote writes
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+    uint64_t supplied = 0;      // lines forwarded to another cache
+    // write-update protocols: words this cache received, and how they ended
+    uint64_t updates_delivered = 0;
+    uint64_t updates_useful = 0;
+    uint64_t updates_wasted = 0;
+    uint64_t update_fallbacks = 0;  // copies this cache gave up to the update limit
+    uint64_t upgrades_avoided = 0;  // first stores to a migratory grant
+    uint64_t migratory_mispredicts = 0; // migratory grants this cache only read
+};
+
+struct CoreCounterField {
+    const char* name;
+    uint64_t CoreCounters::* member;
+};
+inline constexpr CoreCounterField CORE_COUNTER_FIELDS[] = {
+    {"instructions", &CoreCounters::instructions},
+    {"loads",        &CoreCounters::loads},
+    {"stores",       &CoreCounters::stores},
+    {"atomics",      &CoreCounters::atomics},
+    {"compute",      &CoreCounters::compute},
+    {"stall_cycles", &CoreCounters::stall_cycles},
+    {"finish_cycle", &CoreCounters::finish_cycle},
+    {"split",        &CoreCounters::split},
+};
+
+struct CacheCounterField {
+    const char* name;
+    uint64_t CacheCounters::* member;
+};
+inline constexpr CacheCounterField CACHE_COUNTER_FIELDS[] = {
+    {"hits",          &CacheCounters::hits},
+    {"misses",        &CacheCounters::misses},
+    {"bus_rd",        &CacheCounters::bus_rd},
+    {"bus_rdx",       &CacheCounters::bus_rdx},
+    {"bus_upgr",      &CacheCounters::bus_upgr},
+    {"bus_upd",       &CacheCounters::bus_upd},
+    {"bus_atomic",    &CacheCounters::bus_atomic},
+    {"invalidations", &CacheCounters::invalidations},
+    {"evictions",     &CacheCounters::evictions},
+    {"writebacks",    &CacheCounters::writebacks},
+    {"supplied",      &CacheCounters::supplied},
+    {"updates_delivered", &CacheCounters::updates_delivered},
+    {"updates_useful",    &CacheCounters::updates_useful},
+    {"updates_wasted",    &CacheCounters::updates_wasted},
+    {"update_fallbacks",  &CacheCounters::update_fallbacks},
+    {"upgrades_avoided",  &CacheCounters::upgrades_avoided},
+    {"migratory_mispredicts", &CacheCounters::migratory_mispredicts},
 };
 
 class Core;
@@ -27,34 +192,150 @@ class Cache;
 class Bus;
 class Memory;
 class System {
+    friend class ModelChecker;
     public:
-        void record_miss();
-        void record_hit();
-        void record_instruction_retired();
-        void record_bus_rd();
-        void record_bus_rdx();
-        void record_bus_upgr();
-        void record_invalidation();
-        void record_stall_cycle();
+        void record_miss(int cache_id);
+        void record_hit(int cache_id);
+        void record_instruction_retired(int core_id, const MemOp& op);
+        void record_bus_rd(int cache_id);
+        void record_bus_rdx(int cache_id);
+        void record_bus_upgr(int cache_id);
+        void record_bus_upd(int cache_id);
+        void record_update_delivered(int cache_id, bool overwrote_unread);
+        void record_update_read(int cache_id, bool useful);
+        void record_updates_dropped(int cache_id, int words);
+        void record_update_fallback(int cache_id);
+        void record_upgrade_avoided(int cache_id);
+        void record_migratory_mispredict(int cache_id, uint32_t addr);
+        void record_far_atomic(int cache_id);
+        // read half of an atomic, checked to be the latest value
+        void record_atomic_performed(int cache_id, const MemOp& op, uint64_t old);
+        void record_invalidation(int cache_id, uint32_t addr);
+        void record_eviction(int cache_id, uint32_t addr, bool dirty);
+        void record_latency(int core_id, const MemOp& op, bool hit, LatencyReq req, uint64_t cycles);
+        void record_state_change(int cache_id, uint32_t addr, char from, char to);
+        void record_protocol_error(int cache_id, uint32_t addr, const char* what);
+        void record_store_performed(int cache_id, uint32_t addr, const uint8_t* bytes, int size);
+        void check_load(int core_id, uint32_t addr, const uint8_t* bytes, int size);
     
-        System(int num_cores = 2);
+        System(int num_cores = 2, uint32_t mem_bytes = 1 << 20);
+        ~System();
+        System(const System&) = delete;
+        System& operator=(const System&) = delete;
         void run(uint32_t max_cycles);
 
         // helpers and validation
         Core* get_core(int id);
         Cache* get_cache(int id);
         void assert_mesi(uint32_t addr);
+        // invariants are checked incrementally on every line state change;
+        // paranoid mode also cross-checks all caches after each bus grant
+        void set_paranoid_check(bool on);
+        const CoherenceChecker& get_checker() const;
+        // reference memory every completed load is validated against
+        const GoldenMemory& get_golden() const;
+        // false records violations instead of exiting; run() then stops at
+        // the cycle of the first one
+        void set_violations_fatal(bool on);
+        bool has_violation() const;
+        std::string violation_message() const;
+        const CoherenceStats& get_stats() const;
+        const CoreCounters& get_core_counters(int id) const;
+        const CacheCounters& get_cache_counters(int id) const;
+        int get_num_cores() const;
+        const LatencyStats& get_latency() const;
+        void print_latency_report() const;
+        // coherence protocol of every cache; set before the first op
+        void set_protocol(Protocol p);
+        Protocol get_protocol() const;
+        // write-update protocols: invalidate a copy after k updates it never
+        // used (competitive update); 0 updates forever
+        void set_update_limit(uint32_t k);
+        // migratory sharing: a BusRd to a line predicted to be read then
+        // written by one cache at a time is answered with ownership, saving
+        // the BusUpgr. Invalidation protocols only.
+        void set_migratory_sharing(bool on, uint32_t entries = 256, uint32_t threshold = 1);
+        const MigratoryPredictor& get_migratory() const;
+        // atomics that miss or hit a shared copy are performed at memory
+        // instead of taking the line in M
+        void set_far_atomics(bool on);
+        // instructions per cycle at which cores retire COMPUTE ops
+        void set_compute_ipc(double ipc);
+        double get_compute_ipc() const;
+        // data bus width, clock ratio and transfer latencies; traffic counters
+        void configure_bus(const BusConfig& c);
+        const Bus& get_bus() const;
+        // bus/cache-port arbitration policy, weights and wait statistics
+        Arbiter& get_arbiter();
+        const Arbiter& get_arbiter() const;
+        void print_arbitration_report() const;
+        // ready cores waiting longer than the starvation threshold right now
+        int starving_cores() const;
+        uint64_t now() const;
+
+        // event hooks for cores and caches
+        void update_core(int id);
+        void schedule_cache(int cache_id, uint64_t at);
+
+        // false skips the cache dump and DATA ANALYSIS at the end of run()
+        void set_print_report(bool on);
+
+        // host-time breakdown of step(), timing one in sample_every steps
+        void enable_phase_profile(bool on, uint32_t sample_every = 1);
+        const PhaseProfiler& get_phase_profile() const;
+
+        // optional single-pass stack distance profiling of accepted requests
+        void attach_profiler(StackDistanceProfiler* p);
+        // optional Chrome trace timeline of cores, caches and the bus
+        void attach_tracer(TraceExporter* t);
+        // optional time series of the counters, one row every interval cycles
+        void attach_sampler(IntervalSampler* s);
+        // optional MESI transition coverage, used by the fuzzer
+        void attach_coverage(TransitionCoverage* c);
+        // every core pulls its ops from w instead of its trace (closed loop)
+        void attach_workload(Workload* w);
+        int stalled_cores() const;
 
     private:
 
         CoherenceStats stats;
+        std::vector<CoreCounters> core_counters;
+        std::vector<CacheCounters> cache_counters;
+
+        // incremental per-core state, kept current by update_core()
+        CoreSet ready_set;   // has an op and is not stalled
+        CoreSet stalled_set;
+        CoreSet done_set;    // retired its last op
+        CoreSet computing_set; // retiring a COMPUTE op, never ready
+        std::vector<uint64_t> stall_since;
+
+        // caches to step, bucketed by completion cycle
+        static constexpr uint64_t WAKE_SLOTS = 64;
+        std::vector<std::vector<std::pair<uint64_t, int>>> wake_wheel;
+        std::vector<std::pair<uint64_t, int>> due;
+        bool print_report = true;
+        bool violations_fatal = true;
+        Protocol protocol = Protocol::MESI;
+        PhaseProfiler phases;
+        StackDistanceProfiler* profiler = nullptr;
+        LatencyStats latency;
+        Arbiter arbiter;
+        MigratoryPredictor migratory;
+        bool migratory_on = false;
+        double compute_ipc = 1.0;
+        CoherenceChecker checker;
+        GoldenMemory golden;
+        std::vector<std::array<uint64_t, LINE_SIZE>> load_since; // golden versions at load accept
+        std::vector<uint64_t> load_issue;
+        TraceExporter* tracer = nullptr;
+        IntervalSampler* sampler = nullptr;
+        TransitionCoverage* coverage = nullptr;
         
         void step();
 
         uint64_t cycle;
 
         int num_cores;
-        int rr_next;
         
         std::vector<Core*> cores;
         std::vector<Cache*> caches;
@@ -0,0 +1,301 @@
+// test_runner.cpp
+#include "test_runner.hpp"
+#include "log.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+enum class TestStatus { NotRun, Pass, Fail, Timeout, Disabled };
+
+struct TestOutcome {
+    TestStatus status = TestStatus::NotRun;
+    double seconds = 0;
+    int exit_code = 0;   // or the signal number when killed
+    bool signaled = false;
+    std::string output;  // tail of the test's stdout/stderr on failure
+};
+
+const char* status_name(TestStatus s) {
+    switch (s) {
+        case TestStatus::NotRun:   return "skipped";
+        case TestStatus::Pass:     return "pass";
+        case TestStatus::Fail:     return "fail";
+        case TestStatus::Timeout:  return "timeout";
+        case TestStatus::Disabled: return "disabled";
+    }
+    return "?";
+}
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+void json_string(FILE* out, const std::string& s) {
+    fputc('"', out);
+    for (char c : s) {
+        if (c == '"' || c == '\\') { fputc('\\', out); fputc(c, out); }
+        else if (c == '\n') fputs("\\n", out);
+        else if ((unsigned char)c < 0x20) fprintf(out, "\\u%04x", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+void report_one(const TestCase& t, const TestOutcome& o) {
+    const char* tag = o.status == TestStatus::Pass ? "PASS" : (o.status == TestStatus::Timeout ? "TIME" : "FAIL");
+    fprintf(stdout, "[%s] %-72s %8.3f s", tag, t.name, o.seconds);
+    if (o.status == TestStatus::Fail) {
+        fprintf(stdout, o.signaled ? "  (signal %d)" : "  (exit %d)", o.exit_code);
+    }
+    fprintf(stdout, "\n");
+    if (o.status != TestStatus::Pass && !o.output.empty()) {
+        fprintf(stdout, "%s", o.output.c_str());
+        if (o.output.back() != '\n') fprintf(stdout, "\n");
+    }
+    fflush(stdout);
+}
+
+#ifndef _WIN32
+// last few lines of a captured output file
+std::string read_tail(const char* path, size_t max_lines) {
+    FILE* f = fopen(path, "r");
+    if (!f) return "";
+    std::vector<std::string> lines;
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), f)) {
+        lines.push_back(std::string("    ") + buf);
+        if (lines.size() > max_lines) lines.erase(lines.begin());
+    }
+    fclose(f);
+    std::string s;
+    for (auto& l : lines) s += l;
+    return s;
+}
+
+struct Running {
+    size_t index;
+    pid_t pid;
+    Clock::time_point start;
+    std::string log_path;
+};
+
+// the test never ran: fail it with the reason instead of queueing it
+void fail_to_start(const TestCase& t, TestOutcome& o, const char* what) {
+    o.status = TestStatus::Fail;
+    o.exit_code = -1;
+    o.output = std::string("    ") + what + ": " + strerror(errno) + "\n";
+    report_one(t, o);
+}
+
+void run_forked(const TestCase* tests, const std::vector<size_t>& todo, int jobs,
+                double timeout, std::vector<TestOutcome>& out) {
+    std::vector<Running> running;
+    size_t next = 0;
+
+    while (next < todo.size() || !running.empty()) {
+        while (next < todo.size() && (int)running.size() < jobs) {
+            size_t idx = todo[next++];
+            char log_path[] = "/tmp/mesi_test_XXXXXX";
+            int fd = mkstemp(log_path);
+            if (fd < 0) {
+                fail_to_start(tests[idx], out[idx], "mkstemp");
+                continue;
+            }
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if (pid == 0) {
+                dup2(fd, 1);
+                dup2(fd, 2);
+                close(fd);
+                tests[idx].fn();
+                fflush(stdout);
+                _exit(0);
+            }
+            if (pid < 0) {
+                fail_to_start(tests[idx], out[idx], "fork");
+                close(fd);
+                unlink(log_path);
+                continue;
+            }
+            close(fd);
+            running.push_back({idx, pid, Clock::now(), log_path});
+        }
+
+        bool reaped = false;
+        for (size_t r = 0; r < running.size(); r++) {
+            Running& run = running[r];
+            int status = 0;
+            pid_t done = waitpid(run.pid, &status, WNOHANG);
+            double elapsed = seconds_since(run.start);
+            if (done == 0 && elapsed < timeout) continue;
+
+            TestOutcome& o = out[run.index];
+            o.seconds = elapsed;
+            if (done == 0) {
+                kill(run.pid, SIGKILL);
+                waitpid(run.pid, &status, 0);
+                o.status = TestStatus::Timeout;
+            } else if (WIFEXITED(status)) {
+                o.exit_code = WEXITSTATUS(status);
+                o.status = o.exit_code == 0 ? TestStatus::Pass : TestStatus::Fail;
+            } else {
+                o.signaled = true;
+                o.exit_code = WIFSIGNALED(status) ? WTERMSIG(status) : -1;
+                o.status = TestStatus::Fail;
+            }
+            if (o.status != TestStatus::Pass) o.output = read_tail(run.log_path.c_str(), 12);
+            unlink(run.log_path.c_str());
+            report_one(tests[run.index], o);
+
+            running.erase(running.begin() + r);
+            r--;
+            reaped = true;
+        }
+        if (!reaped) usleep(1000);
+    }
+}
+#endif
+
+void run_serial(const TestCase* tests, const std::vector<size_t>& todo, std::vector<TestOutcome>& out) {
+    for (size_t idx : todo) {
+        Clock::time_point t0 = Clock::now();
+        tests[idx].fn(); // a failing assert ends the whole run here
+        TestOutcome& o = out[idx];
+        o.seconds = seconds_since(t0);
+        o.status = TestStatus::Pass;
+        report_one(tests[idx], o);
+    }
+}
+
+bool write_json(const char* path, const TestCase* tests, const std::vector<TestOutcome>& out,
+                double wall, int jobs) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    int counts[5] = {};
+    for (const auto& o : out) counts[(int)o.status]++;
+
+    fprintf(f, "{\n  \"wall_seconds\": %.3f,\n  \"jobs\": %d,\n", wall, jobs);
+    fprintf(f, "  \"passed\": %d,\n  \"failed\": %d,\n  \"timed_out\": %d,\n  \"disabled\": %d,\n  \"skipped\": %d,\n",
+        counts[(int)TestStatus::Pass], counts[(int)TestStatus::Fail], counts[(int)TestStatus::Timeout],
+        counts[(int)TestStatus::Disabled], counts[(int)TestStatus::NotRun]);
+    fprintf(f, "  \"tests\": [\n");
+    for (size_t i = 0; i < out.size(); i++) {
+        const TestOutcome& o = out[i];
+        fprintf(f, "    {\"name\": \"%s\", \"status\": \"%s\", \"seconds\": %.4f",
+            tests[i].name, status_name(o.status), o.seconds);
+        if (o.status == TestStatus::Fail) {
+            fprintf(f, ", \"%s\": %d", o.signaled ? "signal" : "exit_code", o.exit_code);
+        }
+        if (tests[i].disabled) {
+            fprintf(f, ", \"disabled_reason\": ");
+            json_string(f, tests[i].disabled);
+        }
+        if (!o.output.empty()) {
+            fprintf(f, ", \"output\": ");
+            json_string(f, o.output);
+        }
+        fprintf(f, "}%s\n", i + 1 < out.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+} // namespace
+
+int run_test_suite(const TestCase* tests, size_t count, int argc, char** argv) {
+    int jobs = 1;
+#ifndef _WIN32
+    jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    std::vector<const char*> filters;
+    const char* json_path = nullptr;
+    double timeout = 120.0;
+    bool include_disabled = false;
+    bool serial = false;
+    bool list = false;
+
+    for (int i = 1; i < argc; i++) {
+        if      (!strcmp(argv[i], "--jobs") && i + 1 < argc)    jobs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc)  filters.push_back(argv[++i]);
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)    json_path = argv[++i];
+        else if (!strcmp(argv[i], "--timeout") && i + 1 < argc) timeout = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--include-disabled"))        include_disabled = true;
+        else if (!strcmp(argv[i], "--serial"))                  serial = true;
+        else if (!strcmp(argv[i], "--list"))                    list = true;
+        else {
+            fprintf(stderr, "usage: %s [--jobs n] [--filter s]... [--json path] [--timeout secs] "
+                            "[--include-disabled] [--serial] [--list]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (jobs < 1) jobs = 1;
+#ifdef _WIN32
+    serial = true; // no fork()
+#endif
+
+    std::vector<TestOutcome> out(count);
+    std::vector<size_t> todo;
+    for (size_t i = 0; i < count; i++) {
+        bool match = filters.empty();
+        for (const char* f : filters) match |= strstr(tests[i].name, f) != nullptr;
+        if (list) {
+            if (!match) continue;
+            if (tests[i].disabled) fprintf(stdout, "%-72s disabled: %s\n", tests[i].name, tests[i].disabled);
+            else                   fprintf(stdout, "%s\n", tests[i].name);
+            continue;
+        }
+        if (!match) continue;
+        if (tests[i].disabled && !include_disabled) {
+            out[i].status = TestStatus::Disabled;
+            continue;
+        }
+        todo.push_back(i);
+    }
+    if (list) return 0;
+
+    fprintf(stdout, "running %zu tests on %d %s\n", todo.size(), serial ? 1 : jobs,
+        serial ? "thread (in process)" : "workers");
+    Clock::time_point t0 = Clock::now();
+#ifndef _WIN32
+    if (!serial) run_forked(tests, todo, jobs, timeout, out);
+    else
+#endif
+    run_serial(tests, todo, out);
+    double wall = seconds_since(t0);
+
+    int passed = 0, failed = 0, disabled = 0;
+    double test_time = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (out[i].status == TestStatus::Pass) passed++;
+        if (out[i].status == TestStatus::Fail || out[i].status == TestStatus::Timeout) failed++;
+        if (out[i].status == TestStatus::Disabled) {
+            disabled++;
+            fprintf(stdout, "[SKIP] %-72s disabled: %s\n", tests[i].name, tests[i].disabled);
+        }
+        test_time += out[i].seconds;
+    }
+    fprintf(stdout, "\n%d passed, %d failed, %d disabled in %.2f s wall (%.2f s of test time)\n",
+        passed, failed, disabled, wall, test_time);
+
+    if (json_path && !write_json(json_path, tests, out, wall, serial ? 1 : jobs)) {
+        fprintf(stderr, "cannot write %s\n", json_path);
+        return 2;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,26 @@
+#ifndef TEST_RUNNER_HPP
+#define TEST_RUNNER_HPP
+
+#include <cstddef>
+
+struct TestCase {
+    const char* name;
+    void (*fn)();
+    const char* disabled; // nullptr when enabled, otherwise the reason
+};
+
+// Runs the registered tests, each in its own forked process so a failing
+// assert, exit() or leaked global (QUIET) cannot affect the others, up to
+// --jobs at a time. Returns the process exit code: 0 when every selected
+// test passed.
+//
+//   --jobs n            parallel workers (default: online CPUs)
+//   --filter s          only tests whose name contains s (repeatable)
+//   --json path         write a per-test report
+//   --timeout secs      kill tests running longer (default 120)
+//   --include-disabled  also run disabled tests
+//   --serial            run in this process, one after another
+//   --list              print the registry and exit
+int run_test_suite(const TestCase* tests, size_t count, int argc, char** argv);
+
+#endif
@@ -1,9 +1,13 @@
 #include "tests.hpp"
 #include "system.hpp"
+#include "test_runner.hpp"
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdio>
 #include <list>
+#include <string>
 #include "log.cpp"
 #define TEST_START(n) do { QUIET = true;  printf(""); } while (0)
 #define TEST_PASS(n)  do { QUIET = false; printf("[PASS] test%d\n", n); } while (0)
@@ -633,6 +637,10 @@ static void assert_line_invariants(System& sys, uint32_t addr, int ncores) {
     assert(!(m && e));
     if (m) assert(s == 0);
     if (e) assert(s == 0);
+
+    // the incremental checker's shadow directory must agree
+    CoherenceChecker::LineCounts shadow = sys.get_checker().counts(addr);
+    assert(shadow.m == m && shadow.e == e && shadow.s == s);
 }
 static uint32_t lcg_next(uint32_t& x) {
     
@@ -1223,51 +1231,1865 @@ void test35_six_core_two_hot_lines_max_contention_scoreboard() {
     printf("[PASS] test35_six_core_two_hot_lines_max_contention_scoreboard\n");
 }
 
-void run_all_tests() {
-    printf("\n===== RUNNING ALL MESI TESTS =====\n");
+// Tier 6: Analysis tooling
+// Checks the measurement side of the simulator against the protocol itself.
 
-    test1_store_load();
-    
-    test2_upgrade();
-    test3_dirty_eviction();
-    test4_dual_miss();
-    test5_write_write();
-    test6_invalidate_then_read();
-    /*
-    test7_exclusive_hit();
-    test8_e_to_m();
-    test9_ping_pong();
-    test10_false_sharing();
-    test11_clean_eviction();
-    test12_multi_sharer();
-
-    test13_multi_eviction_chain();
-    test14_read_during_eviction();
-    test15_upgrade_after_shared_chain();
-    test16_write_read_write_race();
-    test17_cross_line_false_sharing();
-    test18_repeated_upgrade_downgrade();
-    test19_multi_core_contention();
-    test20_randomized_pattern();
-    
-    test21_round_robin_write_storm_then_all_read();
-    test22_multicore_fuzz_many_lines_invariant_sweep();
-    test23_conflict_eviction_under_remote_reads();
-    test24_two_hot_lines_ping_pong_heavy();
-    test25_multi_address_owner_rotation_and_global_invariants();
-    test26_same_set_thrash_across_cores_invariant_only();
-    test27_dirty_forwarding_value();
-    test28_dirty_eviction_value_visibility();
-    test29_upgrade_invalidation_value_timing();
-
-    test30_six_core_single_line_store_storm_with_immediate_global_reads();
-    test31_three_way_upgrade_race_last_writer_wins_no_transient_dual_M();
-    test32_dirty_eviction_while_other_core_requests_same_line_store();
-    test33_two_address_same_set_cross_core_writeback_visibility_both_lines();
-    test34_four_core_scoreboard_fuzz_with_periodic_global_readback();
-    test35_six_core_two_hot_lines_max_contention_scoreboard();
-    */
-    printf("\n===== ALL TESTS PASSED =====\n");
+void test36_stack_distance_profile_matches_simulated_misses() {
+    QUIET = true;
+
+    // A, B, A -> third access has stack distance 1
+    StackDistanceProfiler small(1, 1, 4);
+    small.record(0, OpType::LOAD, 0x100);
+    small.record(0, OpType::LOAD, 0x200);
+    small.record(0, OpType::LOAD, 0x100);
+    assert(small.histogram(0, 1).cold == 2);
+    assert(small.histogram(0, 1).hist[1] == 1);
+    assert(small.misses(0, 1, 1) == 3);
+    assert(small.misses(0, 1, 2) == 2);
+
+    // A, B, remote store to B, C, A: C fills B's freed way, so A is still
+    // at distance 1 and hits with two ways; B's return is a coherence miss
+    StackDistanceProfiler shared(2, 1, 4);
+    shared.record(0, OpType::LOAD, 0x100);
+    shared.record(0, OpType::LOAD, 0x200);
+    shared.record(1, OpType::STORE, 0x200);
+    shared.record(0, OpType::LOAD, 0x300);
+    shared.record(0, OpType::LOAD, 0x100);
+    shared.record(0, OpType::LOAD, 0x200);
+    assert(shared.histogram(0, 1).hist[1] == 1);
+    assert(shared.histogram(0, 1).cold == 3 && shared.histogram(0, 1).coherence == 1);
+    assert(shared.misses(0, 1, 2) == 4);
+
+    // random shared traffic matches per-core LRU caches that drop a line on
+    // a remote store, for every associativity
+    {
+        const int C = 3;
+        StackDistanceProfiler multi(C, 4, 4);
+        std::vector<std::pair<int, uint32_t>> ops;
+        std::vector<bool> stores;
+        uint32_t seed = 0x51u;
+        for (int k = 0; k < 3000; k++) {
+            uint32_t r = lcg_next(seed);
+            ops.push_back({(int)(r % C), ((r >> 8) % 24) * 32});
+            stores.push_back(((r >> 20) & 7u) == 0);
+            multi.record(ops.back().first, stores.back() ? OpType::STORE : OpType::LOAD, ops.back().second);
+        }
+        for (uint32_t sets = 1; sets <= 4; sets <<= 1) {
+            for (uint32_t ways = 1; ways <= 4; ways <<= 1) {
+                // cache[core][set] holds lines, MRU first
+                std::vector<std::vector<std::vector<uint32_t>>> cache(C, std::vector<std::vector<uint32_t>>(sets));
+                uint64_t misses = 0;
+                for (size_t k = 0; k < ops.size(); k++) {
+                    uint32_t line = ops[k].second / LINE_SIZE;
+                    auto& set = cache[ops[k].first][line % sets];
+                    auto it = std::find(set.begin(), set.end(), line);
+                    if (it == set.end()) misses++;
+                    else set.erase(it);
+                    set.insert(set.begin(), line);
+                    if (set.size() > ways) set.pop_back();
+                    if (!stores[k]) continue;
+                    for (int c = 0; c < C; c++) {
+                        if (c == ops[k].first) continue;
+                        auto& other = cache[c][line % sets];
+                        other.erase(std::remove(other.begin(), other.end(), line), other.end());
+                    }
+                }
+                assert(multi.misses(-1, sets, ways) == misses);
+            }
+        }
+    }
+
+    // a long run over a few lines renumbers its stamps instead of growing
+    // the trees, and the distances survive the renumbering
+    StackDistanceProfiler loop(1, 4, 8);
+    for (int k = 0; k < 100000; k++) loop.record(0, OpType::LOAD, (k % 6) * 32);
+    assert(loop.histogram(0, 1).hist[5] == 100000 - 6);
+    assert(loop.histogram(0, 2).hist[2] == 100000 - 6);
+    // with 4 sets lines 2 and 3 are alone in theirs
+    assert(loop.histogram(0, 4).hist[0] == 2 * 16667 - 2);
+    assert(loop.histogram(0, 4).hist[1] == 100000 - 6 - (2 * 16667 - 2));
+    assert(loop.footprint(0) <= 64 * (1 + 2 + 4));
+
+    // one run covers every geometry; the simulated one is 32 sets x 1 way
+    const int N = 4;
+    System sys(N);
+    StackDistanceProfiler prof(N, 64, 4);
+    sys.attach_profiler(&prof);
+
+    uint32_t seeds[N] = {0x1234u, 0x9876u, 0x5555u, 0xbeefu};
+    for (int cid = 0; cid < N; cid++) {
+        auto* c = sys.get_core(cid);
+        c->clear_trace();
+        for (int k = 0; k < 60; k++) {
+            uint32_t r = lcg_next(seeds[cid]);
+            uint32_t a = 0x60000 + (r % 48) * 32;
+            if ((r >> 29) & 1u) c->add_op(OpType::STORE, a, r & 0xFF);
+            else                c->add_op(OpType::LOAD,  a);
+        }
+    }
+
+    sys.run(20000);
+
+    const CoherenceStats& st = sys.get_stats();
+    assert(prof.accesses(-1) == st.hits + st.misses);
+    assert(prof.misses(-1, 32, 1) == st.misses);
+    assert(prof.misses(-1, 64, 4) <= prof.misses(-1, 32, 1));
+
+    prof.print_miss_ratio_curve();
+
+    QUIET = false;
+    printf("[PASS] test36_stack_distance_profile_matches_simulated_misses\n");
+}
+void test37_latency_histograms_split_by_request_type() {
+    QUIET = true;
+
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 1000; v++) h.record(v);
+    assert(h.count() == 1000);
+    assert(h.percentile(0.0) == 1);
+    assert(h.percentile(0.5) >= 500 && h.percentile(0.5) <= 532);
+    assert(h.percentile(1.0) == 1000);
+
+    System sys(2);
+    auto* c0 = sys.get_core(0);
+    auto* c1 = sys.get_core(1);
+    c0->clear_trace();
+    c1->clear_trace();
+
+    uint32_t A = 0x61000;
+    c0->add_op(OpType::LOAD,  A);      // miss, BusRd
+    c0->add_op(OpType::LOAD,  A);      // hit
+    c1->add_op(OpType::LOAD,  A);      // miss, BusRd -> S
+    c1->add_op(OpType::STORE, A, 3);   // hit in S, BusUpgr
+    c0->add_op(OpType::STORE, A, 4);   // miss, BusRdX
+
+    sys.run(200);
+
+    const LatencyStats& lat = sys.get_latency();
+    const LatencyHistogram& hit = lat.get(0, OpType::LOAD, true, LatencyReq::None);
+    const LatencyHistogram& rd  = lat.get(0, OpType::LOAD, false, LatencyReq::BusRd);
+    assert(hit.count() == 1);
+    assert(rd.count() == 1);
+    assert(rd.percentile(0.5) > hit.percentile(0.5));
+    assert(lat.get(1, OpType::STORE, true, LatencyReq::BusUpgr).count() == 1);
+    assert(lat.get(0, OpType::STORE, false, LatencyReq::BusRdX).count() == 1);
+    assert(lat.total(-1, OpType::LOAD).count() == 3);
+    assert(lat.total(-1, OpType::STORE).count() == 2);
+
+    sys.print_latency_report();
+
+    QUIET = false;
+    printf("[PASS] test37_latency_histograms_split_by_request_type\n");
+}
+void test38_chrome_trace_export_has_all_tracks() {
+    QUIET = true;
+
+    System sys(3);
+    TraceExporter trace(3);
+    sys.attach_tracer(&trace);
+    for (int i = 0; i < 3; i++) sys.get_core(i)->clear_trace();
+
+    uint32_t A = 0x62000;
+    uint32_t B = A + 32 * 32; // same index, different tag
+
+    sys.get_core(0)->add_op(OpType::STORE, A, 1);  // M
+    sys.get_core(1)->add_op(OpType::LOAD,  A);     // snoop, M -> S
+    sys.get_core(2)->add_op(OpType::STORE, A, 2);  // invalidates 0 and 1
+    sys.get_core(2)->add_op(OpType::STORE, B, 3);  // evicts A (dirty)
+
+    sys.run(300);
+
+    FILE* f = tmpfile();
+    assert(f);
+    trace.write_json(f);
+    long size = ftell(f);
+    rewind(f);
+    std::string json(size, '\0');
+    assert(fread(&json[0], 1, size, f) == (size_t)size);
+    fclose(f);
+
+    assert(json.find("\"traceEvents\"") != std::string::npos);
+    assert(json.find("\"name\":\"STORE\"") != std::string::npos);
+    assert(json.find("\"name\":\"BusRdX\"") != std::string::npos);
+    assert(json.find("\"name\":\"arbitration\"") != std::string::npos);
+    assert(json.find("\"name\":\"snoop\"") != std::string::npos);
+    assert(json.find("\"name\":\"invalidate\"") != std::string::npos);
+    assert(json.find("\"name\":\"evict\",\"args\":{\"addr\":\"0x62000\",\"writeback\":true}") != std::string::npos);
+    assert(json.rfind("]}") != std::string::npos);
+
+    QUIET = false;
+    printf("[PASS] test38_chrome_trace_export_has_all_tracks\n");
+}
+void test39_interval_sampler_captures_phases() {
+    QUIET = true;
+
+    const int N = 4;
+    System sys(N);
+    IntervalSampler sampler(50);
+    sys.attach_sampler(&sampler);
+    for (int i = 0; i < N; i++) sys.get_core(i)->clear_trace();
+
+    // phase 1: private lines, phase 2: everyone stores to one line
+    for (int i = 0; i < N; i++) {
+        for (int k = 0; k < 20; k++) sys.get_core(i)->add_op(OpType::LOAD, 0x63000 + i * 32);
+    }
+    sys.run(2000);
+    size_t phase1_rows = sampler.size();
+
+    for (int i = 0; i < N; i++) {
+        for (int k = 0; k < 20; k++) sys.get_core(i)->add_op(OpType::STORE, 0x64000, k);
+    }
+    sys.run(2000);
+
+    assert(sampler.size() > phase1_rows);
+    const std::vector<uint64_t>* inv = sampler.column("invalidations");
+    const std::vector<uint64_t>* cyc = sampler.column("cycles");
+    assert(inv && cyc);
+    assert((*inv)[phase1_rows - 1] == 0);
+    assert(inv->back() > 0);
+    assert(cyc->back() == sys.get_stats().cycles);
+    for (size_t r = 1; r < sampler.size(); r++) assert((*cyc)[r] > (*cyc)[r - 1]);
+    for (double u : sampler.bus_utilization()) assert(u >= 0.0 && u <= 1.0);
+
+    FILE* f = tmpfile();
+    sampler.write_csv(f, true);
+    long csv_size = ftell(f);
+    fclose(f);
+    assert(csv_size > 0);
+
+    QUIET = false;
+    printf("[PASS] test39_interval_sampler_captures_phases\n");
+}
+void test40_per_core_counters_and_stats_export() {
+    QUIET = true;
+
+    static_assert(sizeof(CoreCounters) % HOST_CACHE_LINE == 0, "core counters must be line padded");
+    static_assert(sizeof(CacheCounters) % HOST_CACHE_LINE == 0, "cache counters must be line padded");
+
+    System sys(2);
+    auto* c0 = sys.get_core(0);
+    auto* c1 = sys.get_core(1);
+    c0->clear_trace();
+    c1->clear_trace();
+
+    uint32_t A = 0x65000;
+    c0->add_op(OpType::STORE, A, 9);   // M in c0
+    c0->add_op(OpType::LOAD,  A);      // hit
+    c1->add_op(OpType::LOAD,  A);      // c0 supplies dirty data
+    c1->add_op(OpType::LOAD,  A);      // hit
+
+    sys.run(200);
+
+    const CoreCounters& k0 = sys.get_core_counters(0);
+    const CoreCounters& k1 = sys.get_core_counters(1);
+    assert(k0.instructions == 2 && k0.stores == 1 && k0.loads == 1);
+    assert(k1.instructions == 2 && k1.loads == 2);
+    assert(k0.finish_cycle > 0 && k1.finish_cycle > 0);
+    assert(sys.get_cache_counters(0).supplied == 1);
+    assert(sys.get_cache_counters(1).hits == 1 && sys.get_cache_counters(1).misses == 1);
+    assert(sys.get_cache_counters(0).bus_rdx == 1);
+    assert(sys.get_stats().instructions == k0.instructions + k1.instructions);
+
+    FILE* f = tmpfile();
+    write_stats_json(sys, f);
+    long size = ftell(f);
+    rewind(f);
+    std::string json(size, '\0');
+    assert(fread(&json[0], 1, size, f) == (size_t)size);
+    fclose(f);
+    assert(json.find("\"supplied\": 1") != std::string::npos);
+    assert(json.find("\"num_cores\": 2") != std::string::npos);
+
+    f = tmpfile();
+    write_stats_csv(sys, f);
+    assert(ftell(f) > 0);
+    fclose(f);
+
+    QUIET = false;
+    printf("[PASS] test40_per_core_counters_and_stats_export\n");
+}
+void test41_phase_profiler_accounts_every_phase() {
+    QUIET = true;
+
+    const int N = 4;
+    System sys(N);
+    sys.enable_phase_profile(true);
+    for (int i = 0; i < N; i++) {
+        auto* c = sys.get_core(i);
+        c->clear_trace();
+        for (int k = 0; k < 30; k++) c->add_op(OpType::STORE, 0x66000, k);
+    }
+    sys.run(5000);
+
+    const PhaseProfiler& prof = sys.get_phase_profile();
+    assert(prof.sampled_steps() == sys.get_stats().cycles);
+    assert(prof.phase_count(StepPhase::Arbitration) > 0);
+    assert(prof.phase_count(StepPhase::SnoopFanout) > 0);
+    assert(prof.phase_count(StepPhase::CacheStep) > 0);
+
+    uint64_t sum = 0;
+    for (int p = 0; p < PhaseProfiler::NUM_PHASES; p++) sum += prof.phase_count((StepPhase)p);
+    assert(sum == prof.total_ticks());
+
+    // sampling one step in four
+    System sampled(N);
+    sampled.enable_phase_profile(true, 4);
+    for (int i = 0; i < N; i++) {
+        auto* c = sampled.get_core(i);
+        c->clear_trace();
+        for (int k = 0; k < 30; k++) c->add_op(OpType::STORE, 0x66000, k);
+    }
+    sampled.run(5000);
+    assert(sampled.get_phase_profile().sampled_steps() == sampled.get_stats().cycles / 4);
+
+    QUIET = false;
+    printf("[PASS] test41_phase_profiler_accounts_every_phase\n");
+}
+
+void test42_shadow_directory_paranoid_scan() {
+    QUIET = true;
+
+    const int N = 4;
+    System sys(N);
+    sys.set_paranoid_check(true);
+    for (int i = 0; i < N; i++) sys.get_core(i)->clear_trace();
+
+    // eight lines sharing two cache sets, so evictions mix with sharing
+    uint32_t addrs[8];
+    for (int i = 0; i < 8; i++) addrs[i] = 0x30000 + (uint32_t)(i / 2) * 0x400 + (uint32_t)(i % 2) * 32;
+
+    uint32_t seed = 0xc0ffee11u;
+    for (int step = 0; step < 60; step++) {
+        for (int cid = 0; cid < N; cid++) {
+            uint32_t r = lcg_next(seed);
+            uint32_t a = addrs[(r >> 8) % 8];
+            if ((r >> 31) & 1u) sys.get_core(cid)->add_op(OpType::STORE, a, (int)(r & 0xFF));
+            else                sys.get_core(cid)->add_op(OpType::LOAD, a);
+        }
+    }
+    sys.run(20000);
+
+    const CoherenceChecker& chk = sys.get_checker();
+    assert(chk.scans() == sys.get_stats().bus_grants);
+    assert(chk.transitions() > sys.get_stats().bus_grants);
+    for (int i = 0; i < 8; i++) assert_line_invariants(sys, addrs[i], N);
+
+    // switching paranoid mode off at run time stops the scans
+    sys.set_paranoid_check(false);
+    uint64_t scans = chk.scans();
+    for (int cid = 0; cid < N; cid++) sys.get_core(cid)->add_op(OpType::STORE, addrs[cid], cid);
+    sys.run(2000);
+    assert(chk.scans() == scans);
+    for (int i = 0; i < 8; i++) assert_line_invariants(sys, addrs[i], N);
+
+    QUIET = false;
+    printf("[PASS] test42_shadow_directory_paranoid_scan\n");
+}
+
+void test43_golden_memory_validates_every_load() {
+    QUIET = true;
+
+    // reference model on its own: a load may return any value the byte held
+    // between its accept and its completion
+    GoldenMemory g;
+    uint64_t v0 = g.version(0x100);
+    g.store(1, 0x100, 5, 10);
+    g.store(2, 0x100, 6, 12);
+    assert(g.check_load(0, 0x100, 0, v0, 9, 13));   // initial value still legal
+    assert(g.check_load(0, 0x100, 6, v0, 9, 13));
+    assert(g.check_load(0, 0x104, 0, 0, 9, 13));    // untouched byte
+    uint64_t v2 = g.version(0x100);
+    assert(!g.check_load(3, 0x100, 5, v2, 14, 19)); // overwritten before issue
+    assert(g.stale_reads() == 1);
+    const GoldenMemory::StaleRead& st = g.first_stale();
+    assert(st.core_id == 3 && st.addr == 0x100 && st.got == 5 && st.expected == 6);
+    assert(st.last_writer == 2 && st.last_write_cycle == 12 && st.issue_cycle == 14);
+
+    // every load of a contended run is checked against it
+    const int N = 4;
+    System sys(N);
+    for (int i = 0; i < N; i++) sys.get_core(i)->clear_trace();
+    uint32_t seed = 0x5eed1234u;
+    int loads = 0;
+    for (int step = 0; step < 50; step++) {
+        for (int cid = 0; cid < N; cid++) {
+            uint32_t r = lcg_next(seed);
+            uint32_t a = 0x44000 + ((r >> 8) % 4) * 0x400 + ((r >> 4) % 4);
+            if ((r >> 31) & 1u) {
+                sys.get_core(cid)->add_op(OpType::STORE, a, (int)(r & 0xFF));
+            } else {
+                sys.get_core(cid)->add_op(OpType::LOAD, a);
+                loads++;
+            }
+        }
+    }
+    sys.run(20000);
+
+    const GoldenMemory& golden = sys.get_golden();
+    assert(golden.loads_checked() + golden.loads_unchecked() == (uint64_t)loads);
+    assert(golden.loads_checked() > 0);
+    assert(golden.stale_reads() == 0);
+
+    QUIET = false;
+    printf("[PASS] test43_golden_memory_validates_every_load\n");
+}
+
+void test44_fuzzer_coverage_and_minimizer() {
+    QUIET = true;
+
+    FuzzConfig cfg;
+    cfg.max_cores = 4;
+    cfg.max_ops_per_core = 24;
+
+    // generation is a pure function of the seed
+    FuzzRng a(42), b(42);
+    FuzzTrace ta = fuzz_generate(a, cfg), tb = fuzz_generate(b, cfg);
+    assert(ta.num_cores == tb.num_cores && ta.ops.size() == tb.ops.size());
+    for (size_t i = 0; i < ta.ops.size(); i++) assert(ta.ops[i].addr == tb.ops[i].addr);
+
+    // a short campaign passes and reaches every common transition
+    TransitionCoverage global;
+    FuzzTrace corpus = ta;
+    for (uint64_t i = 0; i < 40; i++) {
+        FuzzRng rng(1000 + i);
+        FuzzTrace t = (i % 2) ? fuzz_mutate(corpus, rng, cfg, &ta) : fuzz_generate(rng, cfg);
+        for (const FuzzOp& op : t.ops) assert(op.core >= 0 && op.core < t.num_cores);
+        TransitionCoverage cov;
+        FuzzResult r = fuzz_run(t, &cov);
+        assert(r.kind == FuzzResult::Pass);
+        if (cov.adds_to(global)) corpus = t;
+        global.merge(cov);
+    }
+    assert(global.covered() >= 25);
+    assert(global.edges_covered() > global.covered());
+    // E/M copies never see BusUpgr: the requester of one holds S
+    assert(global.hits(TransitionCoverage::ACCEPT_POINTS + 2 * TransitionCoverage::NUM_REQS + 2) == 0);
+    assert(global.hits(TransitionCoverage::ACCEPT_POINTS + 3 * TransitionCoverage::NUM_REQS + 2) == 0);
+
+    // a grant the line cannot explain is recorded, not fatal, so the
+    // fuzzer can report it
+    {
+        System sys(1);
+        sys.set_violations_fatal(false);
+        sys.get_core(0)->add_op(OpType::LOAD, 0x2000);
+        sys.run(100);
+        BusGrant g{{0, BusReqType::BusUpgr, 0x2000}, false, false, false, 1, {}};
+        sys.get_cache(0)->on_bus_grant(g);
+        assert(sys.has_violation());
+        assert(sys.violation_message().find("BusUpgr") != std::string::npos);
+        assert(sys.get_cache(0)->state_for(0x2000) == 'E');
+    }
+
+    // ddmin keeps exactly the two ops the failure needs and drops idle cores
+    FuzzTrace big;
+    big.num_cores = 4;
+    FuzzRng rng(7);
+    for (int i = 0; i < 60; i++) {
+        big.ops.push_back({(int)rng.below(4), OpType::LOAD, 0x1000 + rng.below(8) * 32, 0});
+    }
+    big.ops.insert(big.ops.begin() + 17, {3, OpType::STORE, 0x9000, 5});
+    big.ops.insert(big.ops.begin() + 41, {1, OpType::LOAD,  0x9000, 0});
+    auto fails = [](const FuzzTrace& t) {
+        bool st = false, ld = false;
+        for (const FuzzOp& op : t.ops) {
+            st |= op.type == OpType::STORE && op.addr == 0x9000;
+            ld |= op.type == OpType::LOAD && op.addr == 0x9000;
+        }
+        return st && ld;
+    };
+    FuzzTrace min = fuzz_minimize(big, fails);
+    assert(min.ops.size() == 2);
+    assert(min.num_cores == 2);
+    assert(min.ops[0].type == OpType::STORE && min.ops[0].core == 0);
+    assert(min.ops[1].type == OpType::LOAD && min.ops[1].core == 1);
+
+    QUIET = false;
+    printf("[PASS] test44_fuzzer_coverage_and_minimizer\n");
+}
+
+void test45_model_checker_exhausts_small_configs() {
+    QUIET = true;
+
+    // every interleaving of 2 caches over two conflicting addresses
+    ModelCheckConfig cfg;
+    cfg.num_caches = 2;
+    cfg.num_addrs = 2;
+    ModelChecker::Result r = ModelChecker(cfg).run();
+    assert(r.complete && !r.violated);
+    assert(r.states > 1000 && r.depth > 10);
+
+    // on a narrow data bus fills overlap, so pending reservations tell
+    // apart states the caches alone do not
+    ModelCheckConfig narrow = cfg;
+    narrow.bus.width_bytes = 8;
+    ModelChecker::Result nr = ModelChecker(narrow).run();
+    assert(nr.complete && !nr.violated && nr.states > r.states);
+
+    // core-permutation symmetry merges states that differ only in cache ids
+    cfg.num_caches = 3;
+    cfg.num_addrs = 1;
+    ModelChecker::Result sym = ModelChecker(cfg).run();
+    cfg.symmetry = false;
+    ModelChecker::Result full = ModelChecker(cfg).run();
+    assert(sym.complete && full.complete && !sym.violated && !full.violated);
+    assert(sym.states * 3 < full.states);
+
+    // a state limit stops the search without claiming completeness
+    cfg.max_states = 50;
+    ModelChecker::Result cut = ModelChecker(cfg).run();
+    assert(!cut.complete && !cut.violated && cut.states >= 50);
+
+    QUIET = false;
+    printf("[PASS] test45_model_checker_exhausts_small_configs\n");
+}
+
+
+// 8 cores hammering private lines, so every cycle has several ready cores
+static void run_arbitration(System& sys, ArbPolicy policy, uint32_t cycles) {
+    sys.set_print_report(false);
+    sys.get_arbiter().set_policy(policy);
+    for (int i = 0; i < 8; i++) {
+        auto* c = sys.get_core(i);
+        c->clear_trace();
+        for (int k = 0; k < 300; k++) c->add_op(OpType::LOAD, 0x1000 + i * LINE_SIZE, 0);
+    }
+    sys.run(cycles);
+}
+
+void test46_arbitration_policies_fairness_and_starvation() {
+    QUIET = true;
+
+    ArbPolicy parsed;
+    assert(parse_arb_policy("oldest-first", parsed) && parsed == ArbPolicy::OldestFirst);
+    assert(!parse_arb_policy("fifo", parsed));
+
+    // round-robin and oldest-first: equal shares, waits bounded by the core count
+    ArbPolicy fair[2] = {ArbPolicy::RoundRobin, ArbPolicy::OldestFirst};
+    for (ArbPolicy p : fair) {
+        System sys(8);
+        run_arbitration(sys, p, 600);
+        const Arbiter& a = sys.get_arbiter();
+        for (int i = 1; i < 8; i++) {
+            assert(a.grants(i) + 2 >= a.grants(0) && a.grants(0) + 2 >= a.grants(i));
+        }
+        assert(a.total_wait().max() < 8);
+        assert(a.jain_index() > 0.99);
+        assert(a.total_starvation_events() == 0);
+    }
+
+    // fixed priority: the low ids take the port, the high ids starve
+    {
+        System sys(8);
+        sys.get_arbiter().set_starvation_threshold(100);
+        run_arbitration(sys, ArbPolicy::FixedPriority, 600);
+        const Arbiter& a = sys.get_arbiter();
+        assert(a.grants(0) > 250 && a.grants(7) == 0);
+        assert(sys.starving_cores() >= 2); // still waiting since cycle 0
+        assert(a.jain_index() < 0.7);
+    }
+
+    // weighted share: grants follow the 4:1 weight, fair once weight is factored in
+    {
+        System sys(8);
+        sys.get_arbiter().set_weight(0, 4);
+        run_arbitration(sys, ArbPolicy::WeightedShare, 600);
+        const Arbiter& a = sys.get_arbiter();
+        for (int i = 1; i < 8; i++) {
+            assert(a.grants(0) > 3 * a.grants(i) && a.grants(0) < 5 * a.grants(i));
+        }
+        assert(a.jain_index() > 0.95);
+    }
+
+    // lottery: a seeded run is reproducible and favours the heavy ticket holder
+    {
+        uint64_t grants[2][8];
+        for (int run = 0; run < 2; run++) {
+            System sys(8);
+            sys.get_arbiter().set_seed(42);
+            sys.get_arbiter().set_weight(0, 4);
+            run_arbitration(sys, ArbPolicy::Lottery, 600);
+            for (int i = 0; i < 8; i++) grants[run][i] = sys.get_arbiter().grants(i);
+        }
+        for (int i = 0; i < 8; i++) assert(grants[0][i] == grants[1][i]);
+        for (int i = 1; i < 8; i++) assert(grants[0][0] > 2 * grants[0][i]);
+    }
+
+    QUIET = false;
+    printf("[PASS] test46_arbitration_policies_fairness_and_starvation\n");
+}
+
+
+void test47_bus_beats_and_bandwidth() {
+    QUIET = true;
+
+    // defaults keep the flat 5 cycles from grant to completion
+    {
+        System sys(1);
+        auto* c0 = sys.get_core(0);
+        c0->clear_trace();
+        c0->add_op(OpType::LOAD, 0x1000);
+        sys.run(50);
+        assert(sys.get_latency().get(0, OpType::LOAD, false, LatencyReq::BusRd).max() == 5);
+        assert(sys.get_bus().line_cycles() == 1);
+    }
+    // ... also while dirty victims drain between back-to-back fills
+    {
+        // enough cores that a grant lands every cycle
+        const int N = 8;
+        System sys(N);
+        for (int i = 0; i < N; i++) {
+            auto* c = sys.get_core(i);
+            c->clear_trace();
+            // one set, so every miss after the first evicts a dirty line
+            for (int k = 0; k < 12; k++) {
+                uint32_t a = 0x30000 + (uint32_t)(i * 12 + k) * 32 * LINE_SIZE;
+                c->add_op(k % 3 ? OpType::LOAD : OpType::STORE, a, k);
+                c->add_op(OpType::STORE, a, k);
+            }
+        }
+        sys.run(5000);
+        assert(sys.get_stats().writebacks > 40);
+        for (int i = 0; i < N; i++) {
+            assert(sys.get_core(i)->is_finished());
+            const LatencyStats& lat = sys.get_latency();
+            assert(lat.get(i, OpType::LOAD, false, LatencyReq::BusRd).max() == 5);
+            assert(lat.get(i, OpType::STORE, false, LatencyReq::BusRdX).max() == 5);
+        }
+        assert(sys.get_bus().traffic().queued_cycles == 0);
+    }
+
+    // 8-byte bus at half the core clock: 4 beats of 2 cycles per line
+    BusConfig cfg;
+    cfg.width_bytes = 8;
+    cfg.clock_ratio = 2;
+    cfg.mem_latency = 10;
+    cfg.c2c_latency = 3;
+    cfg.upgr_latency = 2;
+
+    System sys(2);
+    sys.configure_bus(cfg);
+    assert(sys.get_bus().line_cycles() == 8);
+    auto* c0 = sys.get_core(0);
+    auto* c1 = sys.get_core(1);
+    uint32_t A = 0x2000, B = 0x3000;
+
+    c0->clear_trace();
+    c1->clear_trace();
+    c0->add_op(OpType::STORE, A, 9);   // memory fill
+    sys.run(100);
+    c1->add_op(OpType::LOAD, A);       // forwarded from c0's M copy
+    sys.run(100);
+    assert(c1->last_load_value == 9);
+    c0->add_op(OpType::LOAD, B);
+    sys.run(100);
+    c1->add_op(OpType::LOAD, B);
+    sys.run(100);
+    c1->add_op(OpType::STORE, B, 1);   // S -> M, address only
+    sys.run(100);
+
+    const LatencyStats& lat = sys.get_latency();
+    assert(lat.get(0, OpType::STORE, false, LatencyReq::BusRdX).max() == 10 + 8);
+    assert(lat.get(1, OpType::LOAD, false, LatencyReq::BusRd).min() == 3 + 8);   // A, forwarded
+    assert(lat.get(1, OpType::LOAD, false, LatencyReq::BusRd).max() == 10 + 8);  // B, clean in c0
+    assert(lat.get(1, OpType::STORE, true, LatencyReq::BusUpgr).max() == 2);
+
+    const BusTraffic& t = sys.get_bus().traffic();
+    assert(t.c2c_lines == 1 && t.mem_lines == 3 && t.addr_only == 1);
+    assert(t.data_cycles == 4 * 8);
+
+    // eight simultaneous misses: the narrow data bus serializes the fills
+    System wide(8), narrow(8);
+    narrow.configure_bus(cfg);
+    for (System* s : {&wide, &narrow}) {
+        for (int i = 0; i < 8; i++) {
+            auto* c = s->get_core(i);
+            c->clear_trace();
+            for (int k = 0; k < 8; k++) c->add_op(OpType::LOAD, 0x10000 + (i * 8 + k) * LINE_SIZE);
+        }
+        s->run(2000);
+    }
+    const BusTraffic& nt = narrow.get_bus().traffic();
+    assert(nt.mem_lines == 64 && nt.queued_cycles > 0);
+    assert(narrow.get_bus().utilization(narrow.get_stats().cycles) > 0.9);
+    assert(wide.get_bus().traffic().queued_cycles == 0);
+    assert(narrow.get_stats().cycles > 4 * wide.get_stats().cycles);
+
+    QUIET = false;
+    printf("[PASS] test47_bus_beats_and_bandwidth\n");
+}
+
+
+void test48_moesi_owner_keeps_dirty_data() {
+    QUIET = true;
+
+    Protocol parsed;
+    assert(parse_protocol("moesi", parsed) && parsed == Protocol::MOESI);
+
+    for (Protocol p : {Protocol::MESI, Protocol::MOESI}) {
+        System sys(4);
+        sys.set_protocol(p);
+        sys.set_paranoid_check(true);
+        uint32_t A = 0x4000;
+        uint32_t B = A + 32 * LINE_SIZE; // same set as A
+
+        for (int i = 0; i < 4; i++) sys.get_core(i)->clear_trace();
+        sys.get_core(0)->add_op(OpType::STORE, A, 77);
+        sys.run(50);
+        for (int i = 1; i < 4; i++) sys.get_core(i)->add_op(OpType::LOAD, A);
+        sys.run(100);
+
+        for (int i = 1; i < 4; i++) assert(sys.get_core(i)->last_load_value == 77);
+        bool moesi = p == Protocol::MOESI;
+        assert(sys.get_cache(0)->state_for(A) == (moesi ? 'O' : 'S'));
+        CoherenceChecker::LineCounts c = sys.get_checker().counts(A);
+        assert(c.o == (moesi ? 1 : 0) && c.s == (moesi ? 3 : 4));
+        // every forward after the first would be a memory write under MESI
+        assert(sys.get_stats().writebacks_avoided == (moesi ? 3u : 0u));
+
+        // O takes part in upgrades like S
+        sys.get_core(2)->add_op(OpType::STORE, A, 78);
+        sys.run(50);
+        assert(sys.get_cache(2)->state_for(A) == 'M');
+        assert(sys.get_cache(0)->state_for(A) == 'I');
+
+        // an evicted O copy is written back
+        sys.get_core(1)->add_op(OpType::LOAD, A);   // c2 M -> O (S under MESI)
+        sys.run(50);
+        sys.get_core(2)->add_op(OpType::LOAD, B);   // evicts c2's copy of A
+        sys.run(50);
+        assert(sys.get_stats().writebacks == (moesi ? 1u : 0u));
+        sys.get_core(3)->add_op(OpType::LOAD, A);
+        sys.run(50);
+        assert(sys.get_core(3)->last_load_value == 78);
+        assert(sys.get_checker().violations() == 0);
+    }
+
+    // exhaustive check of the MOESI transitions on a small configuration
+    ModelCheckConfig cfg;
+    cfg.protocol = Protocol::MOESI;
+    cfg.num_caches = 2;
+    cfg.num_addrs = 2;
+    ModelChecker::Result r = ModelChecker(cfg).run();
+    assert(r.complete && !r.violated);
+
+    QUIET = false;
+    printf("[PASS] test48_moesi_owner_keeps_dirty_data\n");
+}
+
+
+void test49_mesif_forwarder_serves_readers() {
+    QUIET = true;
+
+    BusConfig bus;
+    bus.c2c_latency = 2;
+    bus.mem_latency = 20;
+    uint32_t A = 0x5000;
+    uint32_t B = A + 32 * LINE_SIZE; // same set as A
+
+    uint64_t mean_fill[2];
+    for (Protocol p : {Protocol::MESI, Protocol::MESIF}) {
+        bool mesif = p == Protocol::MESIF;
+        System sys(5);
+        sys.set_protocol(p);
+        sys.configure_bus(bus);
+        sys.set_paranoid_check(true);
+        for (int i = 0; i < 5; i++) sys.get_core(i)->clear_trace();
+
+        // readers one after another; each new reader takes over F
+        for (int i = 0; i < 4; i++) {
+            sys.get_core(i)->add_op(OpType::LOAD, A);
+            sys.run(50);
+            if (mesif && i > 0) {
+                assert(sys.get_cache(i)->state_for(A) == 'F');
+                assert(sys.get_cache(i - 1)->state_for(A) == 'S');
+            }
+        }
+        CoherenceChecker::LineCounts c = sys.get_checker().counts(A);
+        assert(c.f == (mesif ? 1 : 0) && c.s == (mesif ? 3 : 4));
+        assert(sys.get_stats().mem_reads_avoided == (mesif ? 3u : 0u));
+        const BusTraffic& t = sys.get_bus().traffic();
+        mean_fill[mesif] = (t.c2c_fill_cycles + t.mem_fill_cycles) / (t.c2c_lines + t.mem_lines);
+        if (mesif) {
+            // with distinct latencies a forwarded fill is faster than memory
+            assert(t.c2c_lines == 3 && t.mem_lines == 1);
+            assert((double)t.mem_fill_cycles / t.mem_lines - (double)t.c2c_fill_cycles / t.c2c_lines > 0);
+        }
+
+        // the forwarder leaves: the next reader is served by memory, then forwards itself
+        sys.get_core(3)->add_op(OpType::LOAD, B);
+        sys.run(50);
+        sys.get_core(4)->add_op(OpType::LOAD, A);
+        sys.run(50);
+        if (mesif) assert(sys.get_cache(4)->state_for(A) == 'F');
+        assert(sys.get_stats().mem_reads_avoided == (mesif ? 3u : 0u));
+
+        // F upgrades like S
+        sys.get_core(4)->add_op(OpType::STORE, A, 5);
+        sys.run(50);
+        sys.get_core(0)->add_op(OpType::LOAD, A);
+        sys.run(50);
+        assert(sys.get_core(0)->last_load_value == 5);
+        assert(sys.get_checker().violations() == 0);
+    }
+    assert(mean_fill[1] < mean_fill[0]);
+
+    ModelCheckConfig cfg;
+    cfg.protocol = Protocol::MESIF;
+    cfg.num_caches = 3;
+    cfg.num_addrs = 1;
+    ModelChecker::Result r = ModelChecker(cfg).run();
+    assert(r.complete && !r.violated);
+
+    QUIET = false;
+    printf("[PASS] test49_mesif_forwarder_serves_readers\n");
+}
+
+void test50_write_update_protocols() {
+    QUIET = true;
+
+    uint32_t A = 0x6000;
+    uint32_t B = A + 32 * LINE_SIZE; // same set as A
+
+    // producer/consumer: core 0 writes, core 1 reads every value
+    uint64_t misses[3], invalidations[3];
+    int n = 0;
+    for (Protocol p : {Protocol::MESI, Protocol::DRAGON, Protocol::FIREFLY}) {
+        System sys(3);
+        sys.set_protocol(p);
+        sys.set_paranoid_check(true);
+        for (int i = 0; i < 3; i++) sys.get_core(i)->clear_trace();
+
+        for (uint32_t v = 1; v <= 8; v++) {
+            sys.get_core(0)->add_op(OpType::STORE, A, v);
+            sys.run(50);
+            sys.get_core(1)->add_op(OpType::LOAD, A);
+            sys.run(50);
+            assert(sys.get_core(1)->last_load_value == v);
+        }
+        const CoherenceStats& st = sys.get_stats();
+        misses[n] = st.misses;
+        invalidations[n] = st.invalidations;
+
+        if (is_write_update(p)) {
+            // the first store misses alone (M); the other seven update core 1's copy
+            assert(st.bus_upd == 8 && st.bus_upgr == 0);
+            assert(st.updates_delivered == 7 && st.updates_useful == 7 && st.updates_wasted == 0);
+            assert(sys.get_cache(0)->state_for(A) == (p == Protocol::DRAGON ? 'O' : 'S'));
+            assert(sys.get_cache(1)->state_for(A) == 'S');
+
+            // Dragon's owner writes back on eviction; Firefly wrote through already
+            sys.get_core(0)->add_op(OpType::LOAD, B);
+            sys.get_core(1)->add_op(OpType::LOAD, B);
+            sys.run(100);
+            assert(st.writebacks == (p == Protocol::DRAGON ? 1u : 0u));
+            sys.get_core(2)->add_op(OpType::LOAD, A);
+            sys.run(50);
+            assert(sys.get_core(2)->last_load_value == 8);
+        }
+        assert(sys.get_checker().violations() == 0);
+        n++;
+    }
+    // update keeps the consumer's copy: one cold miss each instead of one per value
+    assert(misses[1] < misses[0] && misses[2] < misses[0]);
+    assert(invalidations[0] == 7 && invalidations[1] == 0 && invalidations[2] == 0);
+
+    // words updated twice before a read, or never read, are wasted
+    {
+        System sys(2);
+        sys.set_protocol(Protocol::DRAGON);
+        for (int i = 0; i < 2; i++) sys.get_core(i)->clear_trace();
+        sys.get_core(0)->add_op(OpType::LOAD, A);
+        sys.get_core(1)->add_op(OpType::LOAD, A);
+        sys.run(100);
+        sys.get_core(0)->add_op(OpType::STORE, A, 1);
+        sys.get_core(0)->add_op(OpType::STORE, A, 2);       // overwrites the unread update
+        sys.get_core(0)->add_op(OpType::STORE, A + 4, 3);       // next word
+        sys.run(100);
+        sys.get_core(1)->add_op(OpType::LOAD, A);           // reads word 0 only
+        sys.run(50);
+        assert(sys.get_core(1)->last_load_value == 2);
+        sys.get_core(1)->add_op(OpType::LOAD, B);           // drops word 1 unread
+        sys.run(50);
+        const CoherenceStats& st = sys.get_stats();
+        assert(st.updates_delivered == 3);
+        assert(st.updates_useful == 1 && st.updates_wasted == 2);
+        // all of them landed in the consumer's cache
+        const CacheCounters& c1 = sys.get_cache_counters(1);
+        assert(c1.updates_delivered == 3 && c1.updates_useful == 1 && c1.updates_wasted == 2);
+        assert(sys.get_cache_counters(0).updates_delivered == 0);
+    }
+
+    // competitive update: k unused updates invalidate the copy
+    {
+        System sys(2);
+        sys.set_protocol(Protocol::FIREFLY);
+        sys.set_update_limit(2);
+        sys.set_paranoid_check(true);
+        for (int i = 0; i < 2; i++) sys.get_core(i)->clear_trace();
+        sys.get_core(0)->add_op(OpType::LOAD, A);
+        sys.get_core(1)->add_op(OpType::LOAD, A);
+        sys.run(100);
+        sys.get_core(0)->add_op(OpType::STORE, A, 4);
+        sys.run(50);
+        assert(sys.get_cache(1)->state_for(A) == 'S');
+        sys.get_core(0)->add_op(OpType::STORE, A, 5);
+        sys.run(50);
+        assert(sys.get_cache(1)->state_for(A) == 'I');
+        assert(sys.get_stats().update_fallbacks == 1);
+        assert(sys.get_cache_counters(1).update_fallbacks == 1);
+        // with no sharers left the writer holds M and stores stay local
+        sys.get_core(0)->add_op(OpType::STORE, A, 6);
+        sys.run(50);
+        assert(sys.get_cache(0)->state_for(A) == 'M');
+        assert(sys.get_stats().bus_upd == 2);
+        sys.get_core(1)->add_op(OpType::LOAD, A);
+        sys.run(50);
+        assert(sys.get_core(1)->last_load_value == 6);
+        assert(sys.get_checker().violations() == 0);
+    }
+
+    for (Protocol p : {Protocol::DRAGON, Protocol::FIREFLY}) {
+        for (uint32_t k : {0u, 2u}) {
+            ModelCheckConfig cfg;
+            cfg.protocol = p;
+            cfg.update_limit = k;
+            cfg.num_caches = 3;
+            cfg.num_addrs = 1;
+            ModelChecker::Result r = ModelChecker(cfg).run();
+            assert(r.complete && !r.violated);
+        }
+    }
+
+    QUIET = false;
+    printf("[PASS] test50_write_update_protocols\n");
+}
+
+void test51_migratory_sharing_predictor() {
+    QUIET = true;
+
+    uint32_t A = 0x7000;
+
+    // a counter passed round four cores: each reads it, then writes it
+    uint64_t upgrades[2];
+    for (int on = 0; on < 2; on++) {
+        System sys(4);
+        sys.set_migratory_sharing(on);
+        sys.set_paranoid_check(true);
+        for (int i = 0; i < 4; i++) sys.get_core(i)->clear_trace();
+
+        uint32_t v = 0;
+        for (int round = 0; round < 4; round++) {
+            for (int c = 0; c < 4; c++) {
+                sys.get_core(c)->add_op(OpType::LOAD, A);
+                sys.run(50);
+                assert(sys.get_core(c)->last_load_value == v);
+                sys.get_core(c)->add_op(OpType::STORE, A, ++v);
+                sys.run(50);
+            }
+        }
+        const CoherenceStats& st = sys.get_stats();
+        upgrades[on] = st.bus_upgr;
+        if (on) {
+            // one migration to learn, then every read takes ownership
+            assert(st.migratory_grants == 14 && st.upgrades_avoided == 14);
+            assert(st.migratory_mispredicts == 0);
+            assert(sys.get_migratory().detections() == 1);
+
+            // read-only sharing afterwards: two mispredictions, then plain S
+            for (int c = 0; c < 4; c++) {
+                sys.get_core(c)->add_op(OpType::LOAD, A);
+                sys.run(50);
+                assert(sys.get_core(c)->last_load_value == v);
+            }
+            assert(st.migratory_mispredicts == 2 && st.migratory_grants == 16);
+            // charged to the readers that held the grants: cores 0 and 1
+            assert(sys.get_cache_counters(0).migratory_mispredicts == 1);
+            assert(sys.get_cache_counters(1).migratory_mispredicts == 1);
+            assert(!sys.get_migratory().predict(A));
+            for (int c = 1; c < 4; c++) assert(sys.get_cache(c)->state_for(A) == 'S');
+        }
+        assert(sys.get_checker().violations() == 0);
+    }
+    assert(upgrades[0] == 15 && upgrades[1] == 1);
+
+    // MOESI hands a dirty owner's line on in M, memory still stale
+    {
+        System sys(2);
+        sys.set_protocol(Protocol::MOESI);
+        sys.set_migratory_sharing(true);
+        sys.set_paranoid_check(true);
+        for (int i = 0; i < 2; i++) sys.get_core(i)->clear_trace();
+        for (int round = 0; round < 3; round++) {
+            for (int c = 0; c < 2; c++) {
+                sys.get_core(c)->add_op(OpType::LOAD, A);
+                sys.get_core(c)->add_op(OpType::STORE, A, 10 * round + c + 1);
+                sys.run(100);
+            }
+        }
+        assert(sys.get_cache(1)->state_for(A) == 'M');
+        assert(sys.get_stats().upgrades_avoided == 4);
+        assert(sys.get_cache_counters(0).upgrades_avoided == 2);
+        assert(sys.get_cache_counters(1).upgrades_avoided == 2);
+        assert(sys.get_checker().violations() == 0);
+    }
+
+    for (Protocol p : {Protocol::MESI, Protocol::MOESI}) {
+        ModelCheckConfig cfg;
+        cfg.protocol = p;
+        cfg.migratory = true;
+        cfg.num_caches = 3;
+        cfg.num_addrs = 1;
+        ModelChecker::Result r = ModelChecker(cfg).run();
+        assert(r.complete && !r.violated);
+    }
+
+    QUIET = false;
+    printf("[PASS] test51_migratory_sharing_predictor\n");
+}
+
+void test52_atomics_and_lock_contention() {
+    QUIET = true;
+
+    uint32_t A = 0x8000;
+    uint32_t L = 0x8100; // lock, own line
+
+    // each atomic returns the old byte and leaves the new one
+    {
+        System sys(1);
+        Core* c = sys.get_core(0);
+        c->clear_trace();
+        struct { OpType type; uint32_t data, expected, old; } steps[] = {
+            {OpType::FETCH_ADD, 5, 0, 0},   // 0 -> 5
+            {OpType::CAS,       9, 4, 5},   // fails, stays 5
+            {OpType::CAS,       9, 5, 5},   // 5 -> 9
+            {OpType::SWAP,      2, 0, 9},   // 9 -> 2
+            {OpType::TAS,       0, 0, 2},   // 2 -> 1, found set
+            {OpType::TAS,       0, 0, 1},   // found set, stays 1
+        };
+        for (auto& s : steps) {
+            c->add_op(s.type, A, s.data, s.expected);
+            sys.run(50);
+            assert(c->last_load_value == s.old);
+        }
+        c->add_op(OpType::LOAD, A);
+        sys.run(50);
+        assert(c->last_load_value == 1);
+        const CoherenceStats& st = sys.get_stats();
+        assert(st.atomics == 6 && st.atomic_failures == 3);
+        assert(sys.get_core_counters(0).atomics == 6);
+    }
+
+    // four cores race for one TAS lock: exactly one finds it free
+    {
+        System sys(4);
+        sys.set_paranoid_check(true);
+        for (int i = 0; i < 4; i++) {
+            sys.get_core(i)->clear_trace();
+            sys.get_core(i)->add_op(OpType::TAS, L);
+        }
+        sys.run(200);
+        int winners = 0;
+        for (int i = 0; i < 4; i++) winners += sys.get_core(i)->last_load_value == 0;
+        assert(winners == 1);
+        assert(sys.get_stats().atomic_failures == 3);
+        assert(sys.get_checker().violations() == 0);
+    }
+
+    // a shared counter: near atomics bounce the line between caches, far
+    // atomics leave it at memory
+    uint64_t invalidations[2], cycles[2];
+    for (int far = 0; far < 2; far++) {
+        System sys(4);
+        sys.set_far_atomics(far);
+        sys.set_paranoid_check(true);
+        for (int i = 0; i < 4; i++) {
+            sys.get_core(i)->clear_trace();
+            for (int k = 0; k < 10; k++) sys.get_core(i)->add_op(OpType::FETCH_ADD, A, 1);
+        }
+        sys.run(5000);
+        sys.get_core(0)->add_op(OpType::LOAD, A);
+        sys.run(100);
+        assert(sys.get_core(0)->last_load_value == 40);
+        const CoherenceStats& st = sys.get_stats();
+        assert(st.atomics == 40 && st.atomic_failures == 0);
+        assert(st.far_atomics == (far ? 40u : 0u));
+        assert(sys.get_bus().traffic().far_atomics == st.far_atomics);
+        assert(sys.get_latency().total(-1, OpType::FETCH_ADD).count() == 40);
+        invalidations[far] = st.invalidations;
+        cycles[far] = st.cycles;
+        assert(sys.get_checker().violations() == 0);
+    }
+    assert(invalidations[1] == 0 && invalidations[0] > 20);
+    assert(cycles[1] > 0 && cycles[0] > 0);
+
+    for (bool far : {false, true}) {
+        ModelCheckConfig cfg;
+        cfg.atomics = true;
+        cfg.far_atomics = far;
+        cfg.num_caches = 3;
+        cfg.num_addrs = 1;
+        ModelChecker::Result r = ModelChecker(cfg).run();
+        assert(r.complete && !r.violated);
+    }
+
+    QUIET = false;
+    printf("[PASS] test52_atomics_and_lock_contention\n");
+}
+
+void test53_closed_loop_workloads() {
+    QUIET = true;
+
+    // test-and-test-and-set lock around a plain read-increment-write; the
+    // counter only comes out right if the lock really excludes
+    const uint32_t LOCK = 0x9000, COUNT = 0x9100;
+    const int CORES = 4, ROUNDS = 10;
+    {
+        System sys(CORES);
+        sys.set_paranoid_check(true);
+        CallbackWorkload w(CORES);
+        struct Thread { int step = 0; int rounds = 0; int spins = 0; };
+        std::vector<Thread> th(CORES);
+        for (int c = 0; c < CORES; c++) {
+            Thread& t = th[c];
+            w.on(c, [&t, ROUNDS, LOCK, COUNT](uint32_t last, MemOp& op) {
+                switch (t.step) {
+                    case 1: // saw the lock
+                        if (last != 0) { t.spins++; break; }
+                        op = {OpType::TAS, LOCK, 0};
+                        t.step = 2;
+                        return true;
+                    case 2: // TAS returned the old value
+                        if (last != 0) { t.spins++; break; }
+                        op = {OpType::LOAD, COUNT, 0};
+                        t.step = 3;
+                        return true;
+                    case 3:
+                        op = {OpType::STORE, COUNT, last + 1};
+                        t.step = 4;
+                        return true;
+                    case 4:
+                        op = {OpType::STORE, LOCK, 0};
+                        t.step = 5;
+                        return true;
+                    case 5:
+                        if (++t.rounds == ROUNDS) return false;
+                        break;
+                }
+                op = {OpType::LOAD, LOCK, 0};
+                t.step = 1;
+                return true;
+            });
+        }
+        sys.attach_workload(&w);
+        sys.run(100000);
+
+        int spins = 0;
+        for (int c = 0; c < CORES; c++) {
+            assert(th[c].rounds == ROUNDS);
+            assert(sys.get_core(c)->is_finished());
+            spins += th[c].spins;
+        }
+        assert(spins > 0);
+        assert(sys.get_stats().atomics >= (uint64_t)(CORES * ROUNDS));
+        assert(sys.get_checker().violations() == 0 && !sys.has_violation());
+
+        sys.attach_workload(nullptr);
+        sys.get_core(0)->clear_trace();
+        sys.get_core(0)->add_op(OpType::LOAD, COUNT);
+        sys.run(100);
+        assert(sys.get_core(0)->last_load_value == CORES * ROUNDS);
+    }
+
+    // core 0 builds a linked list and raises a flag; core 1 waits on the
+    // flag, then follows the pointers it loads
+    {
+        const uint32_t BASE = 0xA000, FLAG = 0xA800;
+        const int N = 8;
+        const uint8_t order[N] = {3, 6, 1, 7, 2, 5, 4, 0}; // head is node 0
+        System sys(2);
+        CallbackWorkload w(2);
+        int built = 0;
+        w.on(0, [&](uint32_t, MemOp& op) {
+            if (built > N) return false;
+            if (built == N) op = {OpType::STORE, FLAG, 1};
+            else {
+                // node i points at the node that follows it in `order`
+                uint8_t prev = built == 0 ? 0 : order[built - 1];
+                op = {OpType::STORE, BASE + prev * LINE_SIZE, order[built]};
+            }
+            built++;
+            return true;
+        });
+        std::vector<uint32_t> visited;
+        bool waiting = true;
+        int flag_polls = 0;
+        w.on(1, [&](uint32_t last, MemOp& op) {
+            if (waiting) {
+                if (flag_polls++ == 0 || last == 0) {
+                    op = {OpType::LOAD, FLAG, 0};
+                    return true;
+                }
+                waiting = false;
+                last = 0; // start at the head
+            } else {
+                visited.push_back(last);
+            }
+            if ((int)visited.size() == N) return false;
+            op = {OpType::LOAD, BASE + last * LINE_SIZE, 0};
+            return true;
+        });
+        sys.attach_workload(&w);
+        sys.run(20000);
+
+        assert(flag_polls > 1);
+        assert((int)visited.size() == N);
+        for (int i = 0; i < N; i++) assert(visited[i] == order[i]);
+        assert(!sys.has_violation());
+    }
+
+    QUIET = false;
+    printf("[PASS] test53_closed_loop_workloads\n");
 }
 
+void test54_synthetic_workloads() {
+    QUIET = true;
+
+    // rings: every item arrives intact, SPSC with local tickets and MPMC
+    // with FETCH_ADD tickets wrapping past 256
+    for (int mpmc = 0; mpmc < 2; mpmc++) {
+        RingConfig cfg;
+        cfg.slots = 4;
+        if (mpmc) { cfg.producers = 2; cfg.consumers = 2; cfg.items = 150; }
+        else      { cfg.items = 300; }
+        System sys(4);
+        RingWorkload w(4, cfg, 7);
+        sys.attach_workload(&w);
+        sys.run(2000000);
+        for (int c = 0; c < 4; c++) assert(sys.get_core(c)->is_finished());
+        assert(w.items_consumed() == 300 && w.errors() == 0);
+        assert(w.spins() > 0);
+        assert(!strcmp(w.name(), mpmc ? "mpmc" : "spsc"));
+        assert(sys.get_stats().atomics == (mpmc ? 300u * 2 : 0u));
+        assert(!sys.has_violation());
+    }
+
+    // barrier: nobody leaves a phase early
+    {
+        BarrierConfig cfg;
+        cfg.phases = 5;
+        System sys(4);
+        BarrierWorkload w(4, cfg, 3);
+        sys.attach_workload(&w);
+        sys.run(2000000);
+        for (int c = 0; c < 4; c++) assert(w.phases_done(c) == 5 && sys.get_core(c)->is_finished());
+        assert(sys.get_stats().atomics == 4u * 5);
+        assert(!sys.has_violation());
+    }
+
+    // false sharing: same work, padding only changes the coherence traffic
+    uint64_t inv[2];
+    for (int padded = 0; padded < 2; padded++) {
+        FalseSharingConfig cfg;
+        cfg.padding = padded ? LINE_SIZE : 1;
+        cfg.increments = 50;
+        System sys(4);
+        FalseSharingWorkload w(4, cfg);
+        sys.attach_workload(&w);
+        sys.run(2000000);
+        inv[padded] = sys.get_stats().invalidations;
+        sys.attach_workload(nullptr);
+        for (int c = 0; c < 4; c++) {
+            sys.get_core(c)->clear_trace();
+            sys.get_core(c)->add_op(OpType::LOAD, w.counter_addr(c), 0, 0, 1);
+        }
+        sys.run(1000);
+        for (int c = 0; c < 4; c++) assert(sys.get_core(c)->last_load_value == 50);
+    }
+    assert(inv[0] > 100 && inv[1] == 0);
+
+    // zipf: popularity falls off with rank
+    {
+        ZipfConfig cfg;
+        ZipfWorkload w(1, cfg, 11);
+        std::vector<int> hits(cfg.lines, 0);
+        for (int i = 0; i < 20000; i++) hits[w.draw(0)]++;
+        assert(hits[0] > hits[1] && hits[1] > hits[10] && hits[10] > hits[200]);
+        assert(hits[0] > 20000 / cfg.lines * 20);
+    }
+
+    // streaming: ops come one at a time, nothing is materialized up front
+    {
+        StreamConfig cfg;
+        StreamWorkload w(2, cfg);
+        MemOp op{OpType::LOAD, 0, 0};
+        for (int i = 0; i < 3; i++) {
+            assert(w.next(1, op));
+            assert(op.type == OpType::LOAD && op.addr == cfg.base + cfg.region_bytes + i * cfg.stride);
+        }
+        assert(w.ops_issued(1) == 3 && w.ops_issued(0) == 0);
+    }
 
+    // the standard set: same seed, same run; another seed, another run
+    for (size_t i = 0; i < NUM_SYNTHETIC_WORKLOADS; i++) {
+        const char* name = SYNTHETIC_WORKLOADS[i];
+        uint64_t cycles[3];
+        uint64_t seeds[3] = {1, 1, 2};
+        for (int r = 0; r < 3; r++) {
+            System sys(4);
+            std::unique_ptr<SyntheticWorkload> w = make_synthetic(name, 4, seeds[r]);
+            assert(w && !strcmp(w->name(), name));
+            sys.attach_workload(w.get());
+            sys.run(5000000);
+            for (int c = 0; c < 4; c++) assert(sys.get_core(c)->is_finished());
+            assert(!sys.has_violation());
+            cycles[r] = sys.get_stats().cycles;
+        }
+        assert(cycles[0] == cycles[1]);
+        bool random = strcmp(name, "spsc") && strcmp(name, "mpmc") && strcmp(name, "stream")
+                   && strcmp(name, "false-sharing") && strcmp(name, "padded");
+        if (random) assert(cycles[0] != cycles[2]);
+    }
+    assert(!make_synthetic("nope", 4));
+    assert(!make_synthetic("spsc", 1));
+
+    QUIET = false;
+    printf("[PASS] test54_synthetic_workloads\n");
+}
+
+void test55_trace_import() {
+    QUIET = true;
+
+    auto text_file = [](const std::string& text) {
+        FILE* f = tmpfile();
+        fwrite(text.data(), 1, text.size(), f);
+        rewind(f);
+        return f;
+    };
+    auto contents = [](FILE* f) {
+        std::string s;
+        rewind(f);
+        for (int c; (c = fgetc(f)) != EOF;) s += (char)c;
+        rewind(f);
+        return s;
+    };
+    auto expect = [](BinaryTraceWorkload& w, int core, OpType type, uint32_t addr) {
+        MemOp op{OpType::LOAD, 0, 0};
+        assert(w.next(core, op));
+        assert(op.type == type && op.addr == addr);
+        return op.data;
+    };
+
+    // lackey: fetches and messages skipped, M is a load and a store, a
+    // 64-byte access at line offset 16 touches three lines, pages are
+    // packed in order of first touch
+    {
+        FILE* in = text_file(
+            "==1234== Lackey, an example Valgrind tool\n"
+            "I  04016c0,3\n"
+            " S 7ff000398,8\n"
+            "I  04016c3,5\n"
+            " L 04222cb8,8\n"
+            " M 0421ecc8,4\n"
+            " L 7ff0003f0,64\n");
+        FILE* out = tmpfile();
+        ImportConfig cfg;
+        cfg.num_cores = 2;
+        TraceImporter imp(cfg);
+        assert(imp.convert(in, out));
+        const ImportStats& st = imp.stats();
+        assert(st.lines == 7 && st.accesses == 4 && st.ops == 7 && st.split == 1);
+        assert(st.threads_seen == 1 && st.pages == 3 && st.aliased_pages == 0);
+
+        rewind(out);
+        BinaryTraceWorkload w;
+        assert(w.open(out) && w.num_cores() == 2);
+        assert(expect(w, 0, OpType::STORE, 0x398) == 0);
+        expect(w, 0, OpType::LOAD, 0x1cb8);
+        expect(w, 0, OpType::LOAD, 0x2cc8);
+        assert(expect(w, 0, OpType::STORE, 0x2cc8) == 3);
+        expect(w, 0, OpType::LOAD, 0x3f0);
+        expect(w, 0, OpType::LOAD, 0x400);
+        expect(w, 0, OpType::LOAD, 0x420);
+        MemOp op{OpType::LOAD, 0, 0};
+        assert(!w.next(0, op) && !w.next(1, op));
+        assert(w.records_read() == 7);
+        fclose(in);
+        fclose(out);
+    }
+
+    // drmemtrace: view-tool and T<tid> lines, threads dealt round robin
+    {
+        FILE* in = text_file(
+            "Output format:\n"
+            "<--record#-> <--instr#->: <---tid---> <record details>\n"
+            "------------------------------------------------------------\n"
+            "           1           0:         100 <marker: version 6>\n"
+            "           2           1:         100 ifetch       4 byte(s) @ 0x0000000000401000 non-branch\n"
+            "           3           1:         100 read         8 byte(s) @ 0x00007ffd00001000 by PC 0x0000000000401000\n"
+            "           4           2:         200 write        4 byte(s) @ 0x00007ffd00001004 by PC 0x0000000000401004\n"
+            "           5           3:         300 read         4 byte(s) @ 0x0000000000601000\n"
+            "T300 0x0000000000401008: write 1 byte(s) @ 0x0000000000601010\n");
+        FILE* out = tmpfile();
+        ImportConfig cfg;
+        cfg.format = TraceFormat::DRMEMTRACE;
+        cfg.num_cores = 2;
+        TraceImporter imp(cfg);
+        assert(imp.convert(in, out));
+        assert(imp.stats().accesses == 4 && imp.stats().threads_seen == 3);
+
+        rewind(out);
+        BinaryTraceWorkload w;
+        assert(w.open(out));
+        expect(w, 1, OpType::STORE, 0x4);   // queued past core 0's first record
+        expect(w, 0, OpType::LOAD, 0x0);
+        expect(w, 0, OpType::LOAD, 0x1000);
+        expect(w, 0, OpType::STORE, 0x1010);
+        fclose(in);
+        fclose(out);
+    }
+
+    // the parallel parser emits exactly what the serial one does, even
+    // with slices far smaller than the input
+    {
+        std::string text;
+        uint32_t x = 99;
+        char line[64];
+        for (int i = 0; i < 4000; i++) {
+            uint32_t r = lcg_next(x);
+            char kind = "ISLM"[r % 4];
+            unsigned long long addr = 0x7ff000000ULL + (r >> 8) % 0x40000;
+            unsigned size = 1u << (r >> 4) % 7;
+            if (kind == 'I') snprintf(line, sizeof(line), "I  %llx,%u\n", addr, size);
+            else             snprintf(line, sizeof(line), " %c %llx,%u\n", kind, addr, size);
+            text += line;
+        }
+        FILE* in = text_file(text);
+        std::string result[2];
+        ImportStats serial;
+        for (int par = 0; par < 2; par++) {
+            ImportConfig cfg;
+            cfg.threads = par ? 4 : 1;
+            cfg.chunk_bytes = par ? 256 : 1 << 20;
+            cfg.mem_bytes = 1 << 16;     // force page folding
+            FILE* out = tmpfile();
+            TraceImporter imp(cfg);
+            rewind(in);
+            assert(imp.convert(in, out));
+            assert(imp.stats().lines == 4000 && imp.stats().aliased_pages > 0);
+            result[par] = contents(out);
+            if (!par) serial = imp.stats();
+            fclose(out);
+        }
+        assert(result[0].size() > 12 && result[0] == result[1]);
+
+        // and the result replays on a system
+        FILE* out = tmpfile();
+        fwrite(result[0].data(), 1, result[0].size(), out);
+        rewind(out);
+        BinaryTraceWorkload w;
+        assert(w.open(out));
+        System sys(w.num_cores(), 1 << 16);
+        sys.attach_workload(&w);
+        sys.run(10000000);
+        for (int c = 0; c < w.num_cores(); c++) assert(sys.get_core(c)->is_finished());
+        assert(w.records_read() == serial.ops);
+        assert(sys.get_stats().instructions == serial.ops - serial.compute + serial.compute_instructions);
+        assert(!sys.has_violation());
+        fclose(in);
+        fclose(out);
+    }
+
+    // anything without the header is rejected
+    {
+        FILE* junk = text_file(" L 1000,4\n");
+        BinaryTraceWorkload w;
+        assert(!w.open(junk));
+        assert(!w.open("/nonexistent/trace.mtr"));
+        fclose(junk);
+    }
+
+    // memory smaller than a page is clamped to one, not divided by zero
+    {
+        FILE* in = text_file(" L 1000,4\n S 5000,4\n L 9008,4\n");
+        ImportConfig cfg;
+        cfg.mem_bytes = 100;
+        FILE* out = tmpfile();
+        TraceImporter imp(cfg);
+        assert(imp.convert(in, out));
+        assert(imp.stats().pages == 3 && imp.stats().aliased_pages == 2);
+        rewind(out);
+        BinaryTraceWorkload w;
+        assert(w.open(out));
+        MemOp op;
+        for (int i = 0; i < 3; i++) {
+            assert(w.next(0, op));
+            assert(op.addr < TraceImporter::PAGE_SIZE);
+        }
+        fclose(in);
+        fclose(out);
+    }
+
+    // a clean end of file is not an error; a truncated record, or an
+    // atomic the cores cannot run, stops replay and is flagged
+    auto binary = [](std::vector<std::vector<uint8_t>> recs, size_t tail) {
+        FILE* f = tmpfile();
+        fwrite(BINARY_TRACE_MAGIC, 1, 8, f);
+        const uint8_t cores[4] = {1, 0, 0, 0};
+        fwrite(cores, 1, 4, f);
+        for (auto& r : recs) fwrite(r.data(), 1, r.size(), f);
+        const uint8_t partial[BINARY_TRACE_RECORD] = {};
+        fwrite(partial, 1, tail, f);
+        rewind(f);
+        return f;
+    };
+    const std::vector<uint8_t> ld = {0, (uint8_t)OpType::LOAD, 0x00, 0x10, 0, 0, 0, 0, 0, 0, 4};
+    const std::vector<uint8_t> wide = {0, (uint8_t)OpType::SWAP, 0x00, 0x10, 0, 0, 1, 0, 0, 0, 16};
+    const std::vector<uint8_t> crossing = {0, (uint8_t)OpType::FETCH_ADD, 0x1e, 0x10, 0, 0, 1, 0, 0, 0, 4};
+    struct { std::vector<std::vector<uint8_t>> recs; size_t tail; bool bad; } cases[4] = {
+        {{ld, ld}, 0, false}, {{ld, ld}, 5, true}, {{ld, wide}, 0, true}, {{ld, crossing}, 0, true},
+    };
+    for (auto& c : cases) {
+        FILE* f = binary(c.recs, c.tail);
+        BinaryTraceWorkload w;
+        assert(w.open(f));
+        System sys(1, 1 << 16);
+        sys.attach_workload(&w);
+        sys.run(100000);
+        assert(sys.get_core(0)->is_finished());
+        assert(w.malformed() == c.bad);
+        assert(w.records_read() == (c.bad && c.tail == 0 ? 1u : 2u));
+        assert(!sys.has_violation());
+        fclose(f);
+    }
+
+    QUIET = false;
+    printf("[PASS] test55_trace_import\n");
+}
+
+void test56_compute_records() {
+    QUIET = true;
+
+    // N non-memory instructions delay the next op by N / IPC cycles and
+    // count as instructions, but not as loads, stores or stalls
+    const uint32_t A = 0x25000;
+    uint64_t base_cycles;
+    {
+        System sys(1);
+        sys.get_core(0)->add_op(OpType::LOAD, A);
+        sys.run(1000);
+        base_cycles = sys.get_stats().cycles;
+    }
+    const double ipcs[3] = {1.0, 2.0, 0.5};
+    for (double ipc : ipcs) {
+        System sys(1);
+        sys.set_compute_ipc(ipc);
+        sys.get_core(0)->add_op(OpType::COMPUTE, 0, 8);
+        sys.get_core(0)->add_op(OpType::LOAD, A);
+        sys.run(1000);
+        assert(sys.get_stats().cycles == base_cycles + (uint64_t)(8 / ipc));
+        assert(sys.get_stats().instructions == 9 && sys.get_stats().compute_instructions == 8);
+        const CoreCounters& k = sys.get_core_counters(0);
+        assert(k.instructions == 9 && k.compute == 8 && k.loads == 1 && k.atomics == 0);
+        assert(sys.get_stats().stall_cycles + 8 / ipc < sys.get_stats().cycles);
+        assert(sys.get_stats().hits + sys.get_stats().misses == 1);
+    }
+    // an IPC that does not divide N overshoots on the last cycle: ceil(N / IPC)
+    const double odd_ipcs[3] = {2.0, 4.0, 0.7};
+    for (double ipc : odd_ipcs) {
+        System sys(1);
+        sys.set_compute_ipc(ipc);
+        sys.get_core(0)->add_op(OpType::COMPUTE, 0, 9);
+        sys.get_core(0)->add_op(OpType::LOAD, A);
+        sys.run(1000);
+        assert(sys.get_core(0)->is_finished());
+        assert(sys.get_stats().cycles == base_cycles + (uint64_t)std::ceil(9 / ipc));
+        assert(sys.get_stats().instructions == 10);
+    }
+
+    // think time between contended stores spreads the requests out, so
+    // cores wait less for the bus and CPI drops towards the compute IPC
+    double wait[2], cpi[2];
+    for (int think = 0; think < 2; think++) {
+        System sys(4);
+        for (int c = 0; c < 4; c++) {
+            for (int i = 0; i < 20; i++) {
+                sys.get_core(c)->add_op(OpType::STORE, A, i);
+                if (think) sys.get_core(c)->add_op(OpType::COMPUTE, 0, 50 + 7 * c);
+            }
+        }
+        sys.run(100000);
+        for (int c = 0; c < 4; c++) assert(sys.get_core(c)->is_finished());
+        const CoherenceStats& st = sys.get_stats();
+        assert(st.instructions == 80 + (think ? 20u * (50 * 4 + 7 * 6) : 0u));
+        wait[think] = sys.get_arbiter().total_wait().mean();
+        cpi[think] = (double)st.cycles * 4 / st.instructions;
+        assert(!sys.has_violation());
+    }
+    assert(wait[1] < wait[0] && cpi[1] < cpi[0] && cpi[1] < 1.5);
+
+    // closed-loop workloads can return think time too
+    {
+        System sys(1);
+        CallbackWorkload w(1);
+        int step = 0;
+        w.on(0, [&](uint32_t, MemOp& op) {
+            if (step == 3) return false;
+            op = step++ % 2 ? MemOp{OpType::LOAD, A, 0} : MemOp{OpType::COMPUTE, 0, 5};
+            return true;
+        });
+        sys.attach_workload(&w);
+        sys.run(1000);
+        assert(sys.get_core(0)->is_finished());
+        assert(sys.get_stats().instructions == 11 && sys.get_core_counters(0).loads == 1);
+    }
+
+    // importers turn instructions between data accesses into one COMPUTE
+    // record per gap, per thread
+    {
+        const char* text =
+            "           1           1:         100 ifetch       4 byte(s) @ 0x0000000000401000\n"
+            "           2           2:         200 ifetch       4 byte(s) @ 0x0000000000501000\n"
+            "           3           3:         100 ifetch       4 byte(s) @ 0x0000000000401004\n"
+            "           4           4:         100 ifetch       4 byte(s) @ 0x0000000000401008\n"
+            "           5           4:         100 read         8 byte(s) @ 0x0000000000601000\n"
+            "           6           5:         200 ifetch       4 byte(s) @ 0x0000000000501004\n"
+            "           7           5:         200 write        4 byte(s) @ 0x0000000000601040\n"
+            "           8           6:         100 ifetch       4 byte(s) @ 0x000000000040100c\n"
+            "           9           6:         100 write        1 byte(s) @ 0x0000000000601000\n";
+        FILE* in = tmpfile();
+        fputs(text, in);
+        FILE* out = tmpfile();
+        ImportConfig cfg;
+        cfg.format = TraceFormat::DRMEMTRACE;
+        cfg.num_cores = 2;
+        for (int on = 0; on < 2; on++) {
+            cfg.compute = on;
+            TraceImporter imp(cfg);
+            rewind(in);
+            rewind(out);
+            assert(imp.convert(in, out));
+            assert(imp.stats().compute == (on ? 2u : 0u));
+            assert(imp.stats().compute_instructions == (on ? 3u : 0u));
+        }
+        rewind(out);
+        BinaryTraceWorkload w;
+        assert(w.open(out));
+        MemOp op{OpType::LOAD, 0, 0};
+        assert(w.next(0, op) && op.type == OpType::COMPUTE && op.data == 2);
+        assert(w.next(0, op) && op.type == OpType::LOAD);
+        assert(w.next(0, op) && op.type == OpType::STORE);
+        assert(w.next(1, op) && op.type == OpType::COMPUTE && op.data == 1);
+        assert(w.next(1, op) && op.type == OpType::STORE);
+        assert(!w.next(0, op) && !w.next(1, op));
+        fclose(in);
+        fclose(out);
+    }
+
+    QUIET = false;
+    printf("[PASS] test56_compute_records\n");
+}
+
+void test57_variable_width_accesses() {
+    QUIET = true;
+
+    auto load = [](System& sys, int cid, uint32_t addr, uint8_t size) {
+        Core* c = sys.get_core(cid);
+        c->add_op(OpType::LOAD, addr, 0, 0, size);
+        sys.run(1000);
+        assert(c->is_finished() && c->has_load_value);
+        return c->last_load_value;
+    };
+    auto exec = [](System& sys, int cid, OpType type, uint32_t addr, uint64_t data,
+                   uint64_t expected, uint8_t size) {
+        Core* c = sys.get_core(cid);
+        c->add_op(type, addr, data, expected, size);
+        sys.run(1000);
+        assert(c->is_finished());
+        return c->last_load_value;
+    };
+
+    // little-endian byte assembly for every width, aligned or not
+    const uint32_t A = 0x26000;
+    const uint64_t D = 0x1122334455667788ull;
+    {
+        System sys(2);
+        exec(sys, 0, OpType::STORE, A, D, 0, 8);
+        assert(load(sys, 1, A, 8) == D);
+        assert(load(sys, 1, A, 4) == 0x55667788u);
+        assert(load(sys, 1, A + 4, 4) == 0x11223344u);
+        assert(load(sys, 1, A + 2, 2) == 0x5566u);
+        assert(load(sys, 1, A + 7, 1) == 0x11u);
+        assert(load(sys, 1, A + 1, 8) == D >> 8);   // byte 8 is still zero
+        exec(sys, 0, OpType::STORE, A + 1, 0xabcd, 0, 2);
+        assert(load(sys, 1, A, 4) == 0x55abcd88u);
+
+        // vector stores repeat the 8-byte pattern; loads keep every byte
+        exec(sys, 0, OpType::STORE, A + LINE_SIZE, D, 0, 32);
+        assert(load(sys, 1, A + LINE_SIZE + 8, 16) == D);
+        const std::array<uint8_t, LINE_SIZE>& got = sys.get_core(1)->last_load_bytes;
+        for (int i = 0; i < 16; i++) assert(got[i] == (uint8_t)(D >> 8 * (i % 8)));
+        assert(!sys.has_violation());
+
+        const CoherenceStats& st = sys.get_stats();
+        assert(st.width_1b == 1 && st.width_2b == 2 && st.width_4b == 3);
+        assert(st.width_8b == 3 && st.width_16b == 1 && st.width_32b == 1);
+        assert(st.split_accesses == 0);
+    }
+
+    // a line-crossing access is two transactions but one instruction, and
+    // another core sees all of its bytes
+    {
+        const uint32_t X = A + 3 * LINE_SIZE - 3;
+        System sys(2);
+        exec(sys, 0, OpType::STORE, X, D, 0, 8);
+        const CoherenceStats& st = sys.get_stats();
+        assert(st.bus_rdx == 2 && st.misses == 2 && st.instructions == 1);
+        assert(st.split_accesses == 1 && st.width_8b == 1);
+        assert(load(sys, 1, X, 8) == D);
+        assert(load(sys, 1, X + 3, 4) == (uint32_t)(D >> 24));
+        assert(st.bus_rd == 2 && st.split_accesses == 2);  // the second load hits
+        assert(sys.get_core_counters(1).loads == 2);
+        assert(sys.get_core_counters(0).split == 1 && sys.get_core_counters(1).split == 1);
+        // one latency sample per op, spanning both lines
+        const LatencyStats& lat = sys.get_latency();
+        assert(lat.get(0, OpType::STORE, false, LatencyReq::BusRdX).count() == 1);
+        assert(lat.get(1, OpType::LOAD, false, LatencyReq::BusRd).count() == 1);
+        assert(lat.get(1, OpType::LOAD, true, LatencyReq::None).count() == 1);
+        assert(!sys.has_violation());
+    }
+
+    // write-update protocols broadcast every stored byte, one update per word
+    const Protocol updaters[2] = {Protocol::DRAGON, Protocol::FIREFLY};
+    for (Protocol p : updaters) {
+        System sys(2);
+        sys.set_protocol(p);
+        load(sys, 0, A, 4);
+        load(sys, 1, A, 4);
+        exec(sys, 0, OpType::STORE, A + 2, D, 0, 8);
+        assert(sys.get_stats().bus_upd == 1 && sys.get_stats().updates_delivered == 3);
+        assert(load(sys, 1, A, 8) == (D << 16));
+        assert(load(sys, 1, A + 8, 2) == 0x1122u);
+        assert(sys.get_stats().updates_useful == 3);
+        assert(!sys.has_violation());
+    }
+
+    // atomics act on their whole width, near or far
+    for (int far = 0; far < 2; far++) {
+        System sys(2);
+        sys.set_far_atomics(far);
+        exec(sys, 0, OpType::STORE, A, 0xffffffffull, 0, 8);
+        assert(exec(sys, 1, OpType::FETCH_ADD, A, 1, 0, 8) == 0xffffffffull);
+        assert(load(sys, 0, A, 8) == 0x100000000ull);
+        assert(exec(sys, 1, OpType::CAS, A, D, 0x100000000ull, 8) == 0x100000000ull);
+        assert(exec(sys, 0, OpType::CAS, A, 7, 0x100000000ull, 8) == D);   // fails
+        assert(load(sys, 0, A, 8) == D);
+        // a 2-byte add wraps without carrying into byte 2
+        exec(sys, 0, OpType::STORE, A, 0xffff, 0, 4);
+        assert(exec(sys, 1, OpType::FETCH_ADD, A, 1, 0, 2) == 0xffffu);
+        assert(load(sys, 0, A, 4) == 0);
+        assert(sys.get_stats().atomics == 4 && sys.get_stats().atomic_failures == 1);
+        assert(!sys.has_violation());
+    }
+
+    QUIET = false;
+    printf("[PASS] test57_variable_width_accesses\n");
+}
+
+// ---- test registry ----
+// Every test the runner knows about, in the order run_all_tests() runs them.
+// Disabled tests stay listed with the reason so they show up in reports.
+
+static void test_scaling_write_shared_2()  { test_scaling_write_shared(2); }
+static void test_scaling_write_shared_4()  { test_scaling_write_shared(4); }
+static void test_scaling_write_shared_8()  { test_scaling_write_shared(8); }
+static void test_scaling_write_shared_16() { test_scaling_write_shared(16); }
+static void test_scaling_write_shared_32() { test_scaling_write_shared(32); }
+
+#define TEST(fn) {#fn, fn, nullptr}
+#define TEST_DISABLED(fn, reason) {#fn, fn, reason}
+
+const TestCase ALL_TESTS[] = {
+    // architectural
+    TEST(test1_private_data),
+    TEST(test2_read_only_sharing),
+    TEST(test3_write_sharing_pingpong),
+    TEST(test_scaling_write_shared_2),
+    TEST(test_scaling_write_shared_4),
+    TEST(test_scaling_write_shared_8),
+    TEST(test_scaling_write_shared_16),
+    TEST(test_scaling_write_shared_32),
+
+    TEST(test1_store_load),
+    TEST(test2_upgrade),
+    TEST(test3_dirty_eviction),
+    TEST(test4_dual_miss),
+    TEST(test5_write_write),
+    TEST(test6_invalidate_then_read),
+    TEST(test7_exclusive_hit),
+    TEST(test8_e_to_m),
+    TEST(test9_ping_pong),
+    TEST(test10_false_sharing),
+    TEST(test11_clean_eviction),
+    TEST(test12_multi_sharer),
+    TEST(test13_multi_eviction_chain),
+    TEST(test14_read_during_eviction),
+    TEST(test15_upgrade_after_shared_chain),
+    TEST(test16_write_read_write_race),
+    TEST(test17_cross_line_false_sharing),
+    TEST(test18_repeated_upgrade_downgrade),
+    TEST(test19_multi_core_contention),
+    TEST(test20_randomized_pattern),
+
+    TEST(test21_round_robin_write_storm_then_all_read),
+    TEST(test22_multicore_fuzz_many_lines_invariant_sweep),
+    TEST(test23_conflict_eviction_under_remote_reads),
+    TEST(test24_two_hot_lines_ping_pong_heavy),
+    TEST(test25_multi_address_owner_rotation_and_global_invariants),
+    TEST(test26_same_set_thrash_across_cores_invariant_only),
+    TEST(test27_dirty_forwarding_value),
+    TEST(test28_dirty_eviction_value_visibility),
+    TEST(test29_upgrade_invalidation_value_timing),
+    TEST(test30_six_core_single_line_store_storm_with_immediate_global_reads),
+    TEST(test31_three_way_upgrade_race_last_writer_wins_no_transient_dual_M),
+    TEST(test32_dirty_eviction_while_other_core_requests_same_line_store),
+    TEST(test33_two_address_same_set_cross_core_writeback_visibility_both_lines),
+    TEST(test34_four_core_scoreboard_fuzz_with_periodic_global_readback),
+    TEST(test35_six_core_two_hot_lines_max_contention_scoreboard),
+
+    TEST(test36_stack_distance_profile_matches_simulated_misses),
+    TEST(test37_latency_histograms_split_by_request_type),
+    TEST(test38_chrome_trace_export_has_all_tracks),
+    TEST(test39_interval_sampler_captures_phases),
+    TEST(test40_per_core_counters_and_stats_export),
+    TEST(test41_phase_profiler_accounts_every_phase),
+    TEST(test42_shadow_directory_paranoid_scan),
+    TEST(test43_golden_memory_validates_every_load),
+    TEST(test44_fuzzer_coverage_and_minimizer),
+    TEST(test45_model_checker_exhausts_small_configs),
+    TEST(test46_arbitration_policies_fairness_and_starvation),
+    TEST(test47_bus_beats_and_bandwidth),
+    TEST(test48_moesi_owner_keeps_dirty_data),
+    TEST(test49_mesif_forwarder_serves_readers),
+    TEST(test50_write_update_protocols),
+    TEST(test51_migratory_sharing_predictor),
+    TEST(test52_atomics_and_lock_contention),
+    TEST(test53_closed_loop_workloads),
+    TEST(test54_synthetic_workloads),
+    TEST(test55_trace_import),
+    TEST(test56_compute_records),
+    TEST(test57_variable_width_accesses),
+};
+
+#undef TEST
+#undef TEST_DISABLED
+
+const size_t NUM_TESTS = sizeof(ALL_TESTS) / sizeof(ALL_TESTS[0]);
+
+// in-process, one after another; the first failing assert ends the run
+void run_all_tests() {
+    printf("\n===== RUNNING ALL MESI TESTS =====\n");
+    for (const TestCase& t : ALL_TESTS) {
+        if (!t.disabled) t.fn();
+    }
+    printf("\n===== ALL TESTS PASSED =====\n");
+}
@@ -1,11 +1,10 @@
 // tests.hpp
 
 #include <iostream>
+#include "test_runner.hpp"
 
-class Tests {
-public:
-    void run_all_tests();
-    void run_all_architectural_tests();
-private:
+void run_all_tests();
+void run_all_architectural_tests();
 
-};
+extern const TestCase ALL_TESTS[];
+extern const size_t NUM_TESTS;
@@ -0,0 +1,102 @@
+// trace_export.cpp
+#include "trace_export.hpp"
+#include "core.hpp"
+#include <cstdarg>
+
+static const char* bus_req_name(BusReqType t){
+    switch (t) {
+        case BusReqType::BusRd:   return "BusRd";
+        case BusReqType::BusRdX:  return "BusRdX";
+        case BusReqType::BusUpgr: return "BusUpgr";
+        case BusReqType::BusUpd:  return "BusUpd";
+        case BusReqType::BusAtomic: return "BusAtomic";
+    }
+    return "?";
+}
+
+static std::string fmt_args(const char* fmt, ...){
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return buf;
+}
+
+TraceExporter::TraceExporter(int num_cores_)
+    : num_cores(num_cores_)
+{}
+
+void TraceExporter::op_span(int core_id, OpType op, uint32_t addr, uint64_t data,
+                            bool hit, LatencyReq req, uint64_t begin, uint64_t end){
+    const char* op_name = op_type_name(op);
+    uint64_t dur = end > begin ? end - begin : 1;
+
+    events.push_back({'X', CORES, core_id, begin, dur, op_name,
+        op != OpType::LOAD ? fmt_args("\"addr\":\"0x%x\",\"data\":%llu", addr, (unsigned long long)data)
+                            : fmt_args("\"addr\":\"0x%x\"", addr)});
+    events.push_back({'X', CACHES, core_id, begin, dur,
+        req == LatencyReq::None ? "hit" : latency_req_name(req),
+        fmt_args("\"addr\":\"0x%x\",\"hit\":%s", addr, hit ? "true" : "false")});
+}
+
+void TraceExporter::bus_grant(const BusRequest& req, bool shared, bool flush, uint64_t ts){
+    events.push_back({'X', BUS, 0, ts, 1, bus_req_name(req.type),
+        fmt_args("\"cache\":%d,\"addr\":\"0x%x\",\"shared\":%s,\"flush\":%s",
+            req.cache_id, req.addr, shared ? "true" : "false", flush ? "true" : "false")});
+}
+
+void TraceExporter::arbitration(int winner, int rr_next, uint64_t ts){
+    events.push_back({'i', BUS, 0, ts, 0, "arbitration",
+        fmt_args("\"winner\":%d,\"rr_next\":%d", winner, rr_next)});
+}
+
+void TraceExporter::snoop(int cache_id, const BusRequest& req, bool had_line, bool was_dirty, uint64_t ts){
+    events.push_back({'i', CACHES, cache_id, ts, 0, "snoop",
+        fmt_args("\"req\":\"%s\",\"from\":%d,\"addr\":\"0x%x\",\"had_line\":%s,\"dirty\":%s",
+            bus_req_name(req.type), req.cache_id, req.addr,
+            had_line ? "true" : "false", was_dirty ? "true" : "false")});
+}
+
+void TraceExporter::invalidation(int cache_id, uint32_t addr, uint64_t ts){
+    events.push_back({'i', CACHES, cache_id, ts, 0, "invalidate",
+        fmt_args("\"addr\":\"0x%x\"", addr)});
+}
+
+void TraceExporter::eviction(int cache_id, uint32_t addr, bool dirty, uint64_t ts){
+    events.push_back({'i', CACHES, cache_id, ts, 0, "evict",
+        fmt_args("\"addr\":\"0x%x\",\"writeback\":%s", addr, dirty ? "true" : "false")});
+}
+
+bool TraceExporter::write_json(const char* path) const {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+    write_json(out);
+    fclose(out);
+    return true;
+}
+
+void TraceExporter::write_json(FILE* out) const {
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    // track names
+    const char* procs[3] = {"cores", "caches", "bus"};
+    for (int p = 0; p < 3; p++) {
+        fprintf(out, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"%s\"}},\n", p, procs[p]);
+        fprintf(out, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_sort_index\",\"args\":{\"sort_index\":%d}},\n", p, p);
+    }
+    for (int i = 0; i < num_cores; i++) {
+        fprintf(out, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"core %d\"}},\n", CORES, i, i);
+        fprintf(out, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"cache %d\"}},\n", CACHES, i, i);
+    }
+    fprintf(out, "{\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"name\":\"thread_name\",\"args\":{\"name\":\"bus\"}}", BUS);
+
+    for (const Event& e : events) {
+        fprintf(out, ",\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%llu,",
+            e.ph, e.pid, e.tid, (unsigned long long)e.ts);
+        if (e.ph == 'X') fprintf(out, "\"dur\":%llu,", (unsigned long long)e.dur);
+        else             fprintf(out, "\"s\":\"t\",");
+        fprintf(out, "\"name\":\"%s\",\"args\":{%s}}", e.name, e.args.c_str());
+    }
+    fprintf(out, "\n]}\n");
+}
@@ -0,0 +1,53 @@
+#ifndef TRACE_EXPORT_HPP
+#define TRACE_EXPORT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bus.hpp"
+#include "latency.hpp"
+
+enum class OpType;
+
+// Collects a cycle timeline and writes it as Chrome Trace Event JSON
+// (loadable in chrome://tracing and ui.perfetto.dev). One track per core,
+// one per cache and one for the bus; 1 cycle is shown as 1 us.
+class TraceExporter {
+public:
+    explicit TraceExporter(int num_cores);
+
+    // spans, emitted once the op completes
+    void op_span(int core_id, OpType op, uint32_t addr, uint64_t data,
+                 bool hit, LatencyReq req, uint64_t begin, uint64_t end);
+    void bus_grant(const BusRequest& req, bool shared, bool flush, uint64_t ts);
+
+    // instant events
+    void arbitration(int winner, int rr_next, uint64_t ts);
+    void snoop(int cache_id, const BusRequest& req, bool had_line, bool was_dirty, uint64_t ts);
+    void invalidation(int cache_id, uint32_t addr, uint64_t ts);
+    void eviction(int cache_id, uint32_t addr, bool dirty, uint64_t ts);
+
+    size_t event_count() const { return events.size(); }
+
+    bool write_json(const char* path) const;
+    void write_json(FILE* out) const;
+
+private:
+    enum Track { CORES = 0, CACHES = 1, BUS = 2 };
+
+    struct Event {
+        char ph;          // 'X' complete span, 'i' instant
+        int pid;
+        int tid;
+        uint64_t ts;
+        uint64_t dur;
+        const char* name;
+        std::string args; // preformatted JSON object body
+    };
+
+    int num_cores;
+    std::vector<Event> events;
+};
+
+#endif
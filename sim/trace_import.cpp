@@ -0,0 +1,323 @@
+// trace_import.cpp
+#include "trace_import.hpp"
+#include "config.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// lines are parsed from a NUL-terminated copy; longer lines are truncated,
+// which only ever drops trailing detail such as drmemtrace's "by PC"
+static size_t copy_line(const char* line, size_t len, char* buf, size_t cap){
+    if (len >= cap) len = cap - 1;
+    memcpy(buf, line, len);
+    buf[len] = 0;
+    return len;
+}
+
+static bool parse_uint(const char* s, int base, uint64_t& out){
+    if (!*s) return false;
+    char* end;
+    out = strtoull(s, &end, base);
+    return *end == 0 || *end == ',' || *end == ':';
+}
+
+// ---- Lackey ----
+// "I  04016c0,3" instruction fetch, " L 04222cb8,8", " S ...", " M ..."
+
+bool parse_lackey_line(const char* line, size_t len, RawAccess& out){
+    char buf[128];
+    copy_line(line, len, buf, sizeof(buf));
+    const char* p = buf;
+    while (*p == ' ') p++;
+    char kind = *p;
+    if (!kind || !strchr("ILSM", kind) || p[1] != ' ') return false;
+    p++;
+    while (*p == ' ') p++;
+
+    char* end;
+    out.addr = strtoull(p, &end, 16);
+    if (end == p || *end != ',') return false;
+    p = end + 1;
+    out.size = (uint32_t)strtoul(p, &end, 10);
+    if (end == p) return false;
+    out.kind = kind;
+    out.tid = 0; // lackey serializes all threads into one stream
+    return true;
+}
+
+// ---- drmemtrace ----
+// view tool: "   15     3:     1320993 read    8 byte(s) @ 0x00007ffd... by PC 0x..."
+// with ifetch lines for instructions
+// older dumps put the thread first as "T1320993"; either way the thread id
+// is the last numeric token before read/write
+
+bool parse_drmemtrace_line(const char* line, size_t len, RawAccess& out){
+    char buf[256];
+    copy_line(line, len, buf, sizeof(buf));
+
+    static constexpr int MAX_TOK = 16;
+    char* tok[MAX_TOK];
+    int n = 0;
+    for (char* s = buf; *s && n < MAX_TOK;) {     // not strtok: slices parse in parallel
+        while (*s == ' ' || *s == '\t' || *s == '\r') *s++ = 0;
+        if (!*s) break;
+        tok[n++] = s;
+        while (*s && *s != ' ' && *s != '\t' && *s != '\r') s++;
+    }
+
+    int k = 0;
+    while (k < n && strcmp(tok[k], "read") && strcmp(tok[k], "write") && strcmp(tok[k], "ifetch")) k++;
+    if (k == n || k + 4 >= n) return false;
+
+    uint64_t size;
+    if (!parse_uint(tok[k + 1], 10, size) || strcmp(tok[k + 3], "@")) return false;
+    if (!parse_uint(tok[k + 4], 16, out.addr)) return false;
+
+    bool have_tid = false;
+    for (int i = k - 1; i >= 0 && !have_tid; i--) {
+        const char* t = tok[i][0] == 'T' ? tok[i] + 1 : tok[i];
+        // record#/instr# columns end in ':' too; the tid is the one after them
+        if (isdigit((unsigned char)t[0]) && parse_uint(t, 10, out.tid)) have_tid = true;
+    }
+    if (!have_tid) return false;
+
+    out.size = (uint32_t)size;
+    out.kind = tok[k][0] == 'r' ? 'L' : (tok[k][0] == 'w' ? 'S' : 'I');
+    return true;
+}
+
+// ---- TraceImporter ----
+
+TraceImporter::TraceImporter(const ImportConfig& cfg_)
+    : cfg(cfg_)
+{
+    if (cfg.num_cores < 1) cfg.num_cores = 1;
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.chunk_bytes < 256) cfg.chunk_bytes = 256;
+    if (cfg.mem_bytes < PAGE_SIZE) cfg.mem_bytes = PAGE_SIZE;
+    cfg.mem_bytes -= cfg.mem_bytes % PAGE_SIZE;
+}
+
+void TraceImporter::parse_slice(const char* begin, const char* end,
+                                std::vector<RawAccess>& out, uint64_t& lines) const {
+    auto parse = cfg.format == TraceFormat::LACKEY ? parse_lackey_line : parse_drmemtrace_line;
+    while (begin < end) {
+        const char* nl = (const char*)memchr(begin, '\n', end - begin);
+        const char* stop = nl ? nl : end;
+        RawAccess a;
+        if (parse(begin, stop - begin, a)) out.push_back(a);
+        lines++;
+        begin = stop + 1;
+    }
+}
+
+uint32_t TraceImporter::map_addr(uint64_t addr){
+    uint64_t page = addr / PAGE_SIZE;
+    auto it = page_of.find(page);
+    if (it == page_of.end()) {
+        uint32_t sim_pages = cfg.mem_bytes / PAGE_SIZE;
+        uint32_t idx = (uint32_t)st.pages++;
+        if (idx >= sim_pages) {
+            st.aliased_pages++;
+            idx %= sim_pages;
+        }
+        it = page_of.emplace(page, idx).first;
+    }
+    return it->second * PAGE_SIZE + (uint32_t)(addr % PAGE_SIZE);
+}
+
+void TraceImporter::put(int core, OpType type, uint32_t addr, uint32_t data, uint8_t size){
+    uint8_t rec[BINARY_TRACE_RECORD] = {
+        (uint8_t)core, (uint8_t)type,
+        (uint8_t)addr, (uint8_t)(addr >> 8), (uint8_t)(addr >> 16), (uint8_t)(addr >> 24),
+        (uint8_t)data, (uint8_t)(data >> 8), (uint8_t)(data >> 16), (uint8_t)(data >> 24),
+        size,
+    };
+    outbuf.insert(outbuf.end(), rec, rec + BINARY_TRACE_RECORD);
+    st.ops++;
+}
+
+void TraceImporter::emit(const RawAccess& a){
+    auto it = thread_of.find(a.tid);
+    if (it == thread_of.end()) {
+        Thread t{(int)(st.threads_seen++ % (uint64_t)cfg.num_cores), 0};
+        it = thread_of.emplace(a.tid, t).first;
+    }
+    Thread& th = it->second;
+    if (a.kind == 'I') {
+        th.fetched++;
+        return;
+    }
+    int core = th.core;
+    st.accesses++;
+
+    if (cfg.compute && th.fetched > 1) {
+        uint64_t n = th.fetched - 1;
+        st.compute_instructions += n;
+        for (; n; n -= std::min<uint64_t>(n, UINT32_MAX)) {
+            put(core, OpType::COMPUTE, 0, (uint32_t)std::min<uint64_t>(n, UINT32_MAX));
+            st.compute++;
+        }
+    }
+    th.fetched = 0;
+
+    uint64_t end = a.addr + (a.size ? a.size : 1);
+    uint64_t first = a.addr / LINE_SIZE;
+    uint64_t last = (end - 1) / LINE_SIZE;
+    if (last > first) st.split++;
+
+    // one op per line: consecutive source lines may land on different pages
+    for (uint64_t l = first; l <= last; l++) {
+        uint64_t from = l == first ? a.addr : l * LINE_SIZE;
+        uint8_t size = (uint8_t)(std::min(end, (l + 1) * LINE_SIZE) - from);
+        uint32_t addr = map_addr(from);
+        // the source traces carry no values; stores write the record number
+        if (a.kind != 'S') put(core, OpType::LOAD, addr, 0, size);
+        if (a.kind != 'L') put(core, OpType::STORE, addr, (uint32_t)(st.ops & 0xff), size);
+    }
+}
+
+bool TraceImporter::convert(FILE* in, FILE* out){
+    uint8_t header[12];
+    memcpy(header, BINARY_TRACE_MAGIC, 8);
+    for (int i = 0; i < 4; i++) header[8 + i] = (uint8_t)((uint32_t)cfg.num_cores >> (8 * i));
+    fwrite(header, 1, sizeof(header), out);
+
+    const size_t round = cfg.chunk_bytes * (size_t)cfg.threads;
+    std::vector<char> buf, carry;
+    std::vector<std::vector<RawAccess>> parts(cfg.threads);
+    std::vector<uint64_t> lines(cfg.threads);
+
+    for (bool at_eof = false; !at_eof;) {
+        buf.swap(carry);
+        carry.clear();
+        size_t old = buf.size();
+        buf.resize(old + round);
+        size_t got = fread(buf.data() + old, 1, round, in);
+        buf.resize(old + got);
+        at_eof = got < round;
+
+        // hold back the partial last line for the next round
+        if (!at_eof) {
+            size_t cut = buf.size();
+            while (cut > 0 && buf[cut - 1] != '\n') cut--;
+            if (cut == 0) { carry.swap(buf); continue; }
+            carry.assign(buf.begin() + cut, buf.end());
+            buf.resize(cut);
+        }
+
+        // one slice per thread, each ending on a line boundary
+        const char* p = buf.data();
+        const char* end = p + buf.size();
+        std::vector<std::thread> pool;
+        for (int t = 0; t < cfg.threads; t++) {
+            const char* stop = t == cfg.threads - 1 ? end : p + (end - p) / (cfg.threads - t);
+            while (stop > p && stop < end && stop[-1] != '\n') stop++;
+            parts[t].clear();
+            lines[t] = 0;
+            if (cfg.threads == 1) parse_slice(p, stop, parts[t], lines[t]);
+            else pool.emplace_back([this, p, stop, &parts, &lines, t] { parse_slice(p, stop, parts[t], lines[t]); });
+            p = stop;
+        }
+        for (std::thread& th : pool) th.join();
+
+        // thread and page assignment depend on order, so emit serially
+        for (int t = 0; t < cfg.threads; t++) {
+            st.lines += lines[t];
+            for (const RawAccess& a : parts[t]) emit(a);
+        }
+        fwrite(outbuf.data(), 1, outbuf.size(), out);
+        outbuf.clear();
+    }
+    return !ferror(in) && !ferror(out);
+}
+
+bool TraceImporter::convert(const char* in_path, const char* out_path){
+    FILE* in = strcmp(in_path, "-") ? fopen(in_path, "rb") : stdin;
+    if (!in) return false;
+    FILE* out = fopen(out_path, "wb");
+    if (!out) {
+        if (in != stdin) fclose(in);
+        return false;
+    }
+    bool ok = convert(in, out);
+    if (in != stdin) fclose(in);
+    return fclose(out) == 0 && ok;
+}
+
+// ---- BinaryTraceWorkload ----
+
+BinaryTraceWorkload::~BinaryTraceWorkload(){
+    if (owned && in) fclose(in);
+}
+
+bool BinaryTraceWorkload::open(const char* path){
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    if (!open(f)) {
+        fclose(f);
+        return false;
+    }
+    owned = true;
+    return true;
+}
+
+bool BinaryTraceWorkload::open(FILE* f){
+    uint8_t header[12];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header)) return false;
+    if (memcmp(header, BINARY_TRACE_MAGIC, 8)) return false;
+    uint32_t n = 0;
+    for (int i = 0; i < 4; i++) n |= (uint32_t)header[8 + i] << (8 * i);
+    if (n == 0 || n > 256) return false;
+
+    if (owned && in) fclose(in);
+    in = f;
+    owned = false;
+    eof = false;
+    bad = false;
+    cores = (int)n;
+    records = 0;
+    queued.assign(n, {});
+    return true;
+}
+
+// replay ends at the first record it cannot run; anything but a clean end
+// of file is reported and flagged
+bool BinaryTraceWorkload::reject(const char* why){
+    fprintf(stderr, "binary trace record %llu: %s\n", (unsigned long long)records, why);
+    bad = true;
+    eof = true;
+    return false;
+}
+
+bool BinaryTraceWorkload::read_record(){
+    uint8_t rec[BINARY_TRACE_RECORD];
+    size_t got = fread(rec, 1, sizeof(rec), in);
+    if (got == 0 && !ferror(in)) {
+        eof = true;
+        return false;
+    }
+    if (got != sizeof(rec)) return reject("truncated");
+    if (rec[0] >= cores) return reject("core out of range");
+    if (rec[1] > (uint8_t)OpType::COMPUTE) return reject("unknown op type");
+    if (rec[10] == 0 || rec[10] > LINE_SIZE) return reject("bad access size");
+    uint32_t addr = rec[2] | rec[3] << 8 | rec[4] << 16 | (uint32_t)rec[5] << 24;
+    uint32_t data = rec[6] | rec[7] << 8 | rec[8] << 16 | (uint32_t)rec[9] << 24;
+    MemOp op{(OpType)rec[1], addr, data, 0, rec[10]};
+    if (is_atomic(op.type) && (op.size > 8 || crosses_line(op)))
+        return reject("atomic wider than 8 bytes or crossing a line");
+    queued[rec[0]].push_back(op);
+    records++;
+    return true;
+}
+
+bool BinaryTraceWorkload::next(int core, MemOp& op){
+    if (!in || core >= cores) return false;
+    while (queued[core].empty() && !eof) read_record();
+    if (queued[core].empty()) return false;
+    op = queued[core].front();
+    queued[core].pop_front();
+    return true;
+}
@@ -0,0 +1,129 @@
+#ifndef TRACE_IMPORT_HPP
+#define TRACE_IMPORT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "workload.hpp"
+
+enum class TraceFormat {
+    LACKEY,     // valgrind --tool=lackey --trace-mem=yes
+    DRMEMTRACE  // drcachesim -simulator_type view (text)
+};
+
+// One record as the source trace states it, before it is split into lines
+// and moved into the simulated address space. kind is 'L', 'S', 'M' (load
+// then store) or 'I' for an instruction fetch.
+struct RawAccess {
+    uint64_t tid;
+    uint64_t addr;
+    uint32_t size;
+    char kind;
+};
+
+// false for lines that carry no access (markers, valgrind messages, blank
+// or malformed lines)
+bool parse_lackey_line(const char* line, size_t len, RawAccess& out);
+bool parse_drmemtrace_line(const char* line, size_t len, RawAccess& out);
+
+struct ImportConfig {
+    TraceFormat format = TraceFormat::LACKEY;
+    int num_cores = 4;
+    int threads = 1;               // parser threads
+    size_t chunk_bytes = 1 << 20;  // input per parser thread per round
+    uint32_t mem_bytes = 1 << 20;  // simulated memory the pages are packed into
+    bool compute = true;           // COMPUTE records for instructions without data accesses
+};
+
+struct ImportStats {
+    uint64_t lines = 0;
+    uint64_t accesses = 0;         // data accesses parsed
+    uint64_t ops = 0;              // records written
+    uint64_t split = 0;            // accesses spanning more than one line
+    uint64_t compute = 0;          // COMPUTE records written
+    uint64_t compute_instructions = 0;
+    uint64_t threads_seen = 0;
+    uint64_t pages = 0;            // distinct source pages
+    uint64_t aliased_pages = 0;    // pages folded onto an already used one
+};
+
+// Binary trace: the magic "MESITRC2", a u32 core count, then one 11-byte
+// record per op: u8 core, u8 OpType, u32 addr, u32 data (little endian),
+// u8 access size.
+static constexpr char BINARY_TRACE_MAGIC[8] = {'M', 'E', 'S', 'I', 'T', 'R', 'C', '2'};
+static constexpr size_t BINARY_TRACE_RECORD = 11;
+
+// Streams a text trace into the binary format. Input is read in rounds of
+// threads * chunk_bytes, cut at line boundaries and parsed in parallel;
+// records are then emitted in input order. Thread ids go to cores in order
+// of first appearance (round robin past num_cores). Source pages are
+// packed into simulated memory on first touch, so sharing and spatial
+// locality survive; accesses spanning lines become one op per line. The
+// instructions a thread fetched between two data accesses, less the one
+// making the access, become a single COMPUTE record.
+class TraceImporter {
+public:
+    static constexpr uint32_t PAGE_SIZE = 4096;
+
+    // mem_bytes is clamped to at least one page and rounded down to pages
+    explicit TraceImporter(const ImportConfig& cfg);
+
+    bool convert(FILE* in, FILE* out);
+    bool convert(const char* in_path, const char* out_path);
+
+    const ImportStats& stats() const { return st; }
+
+private:
+    ImportConfig cfg;
+    ImportStats st;
+    struct Thread {
+        int core;
+        uint64_t fetched;   // instructions since the last data access
+    };
+    std::unordered_map<uint64_t, Thread> thread_of;
+    std::unordered_map<uint64_t, uint32_t> page_of;  // source page -> simulated page
+    std::vector<uint8_t> outbuf;
+
+    void parse_slice(const char* begin, const char* end,
+                     std::vector<RawAccess>& out, uint64_t& lines) const;
+    uint32_t map_addr(uint64_t addr);
+    void emit(const RawAccess& a);
+    void put(int core, OpType type, uint32_t addr, uint32_t data, uint8_t size = 4);
+};
+
+// Replays a binary trace as a workload. Records are read on demand and
+// queued per core until that core asks, so memory stays bounded as long as
+// the cores' records are interleaved in the file.
+class BinaryTraceWorkload : public Workload {
+public:
+    BinaryTraceWorkload() = default;
+    ~BinaryTraceWorkload();
+
+    // false if the file is missing or not a binary trace
+    bool open(const char* path);
+    bool open(FILE* f);     // not owned, read from its current position
+
+    int num_cores() const { return cores; }
+    uint64_t records_read() const { return records; }
+    // replay stopped at a truncated or malformed record rather than at a
+    // clean end of file
+    bool malformed() const { return bad; }
+
+    bool next(int core, MemOp& op) override;
+
+private:
+    FILE* in = nullptr;
+    bool owned = false;
+    bool eof = false;
+    bool bad = false;
+    int cores = 0;
+    uint64_t records = 0;
+    std::vector<std::deque<MemOp>> queued;
+
+    bool read_record();
+    bool reject(const char* why);
+};
+
+#endif
@@ -0,0 +1,22 @@
+// workload.cpp
+#include "workload.hpp"
+#include <cassert>
+
+CallbackWorkload::CallbackWorkload(int num_cores)
+    : fns(num_cores), last(num_cores, 0)
+{}
+
+void CallbackWorkload::on(int core, Fn fn){
+    assert(core >= 0 && core < (int)fns.size());
+    fns[core] = std::move(fn);
+}
+
+bool CallbackWorkload::next(int core, MemOp& op){
+    if (core >= (int)fns.size() || !fns[core]) return false;
+    op = MemOp{OpType::LOAD, 0, 0};
+    return fns[core](last[core], op);
+}
+
+void CallbackWorkload::complete(int core, const MemOp& /*op*/, uint64_t value){
+    if (core < (int)last.size()) last[core] = value;
+}
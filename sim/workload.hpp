@@ -0,0 +1,49 @@
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "core.hpp"
+
+// Closed-loop op source. A core asks for its next op only once the
+// previous one completed, and is told the value that op returned, so a
+// workload can spin on a flag, retry a lock or chase pointers. Ops are
+// generated on demand; nothing is stored per core beyond the op in flight.
+class Workload {
+public:
+    virtual ~Workload() = default;
+
+    // next op of `core`; false once that core is done for good
+    virtual bool next(int core, MemOp& op) = 0;
+    // `op` completed; value is what a load read, or an atomic's old value
+    virtual void complete(int /*core*/, const MemOp& /*op*/, uint64_t /*value*/) {}
+};
+
+// One callback per core, called with the value the core's previous op
+// returned (0 before the first) and filling in the next op. State lives in
+// the captures:
+//
+//   int spins = 0;
+//   w.on(0, [&](uint64_t last, MemOp& op) {
+//       if (spins++ && last == 0) return false;  // acquired
+//       op = {OpType::TAS, LOCK, 0};
+//       return true;
+//   });
+class CallbackWorkload : public Workload {
+public:
+    using Fn = std::function<bool(uint64_t last, MemOp& op)>;
+
+    explicit CallbackWorkload(int num_cores);
+
+    void on(int core, Fn fn);
+
+    bool next(int core, MemOp& op) override;
+    void complete(int core, const MemOp& op, uint64_t value) override;
+
+private:
+    std::vector<Fn> fns;
+    std::vector<uint64_t> last;
+};
+
+#endif